@@ -9,6 +9,8 @@
 #include "esp_err.h"
 #include "led_strip_rmt.h"
 #include "led_strip_spi.h"
+#include "led_strip_apa102.h"
+#include "led_strip_transform.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +52,26 @@ esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t
  */
 esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
 
+/**
+ * @brief Set a range of consecutive pixels from a buffer
+ *
+ * @note The range is checked once, so this is much cheaper than calling `led_strip_set_pixel` for every pixel
+ * @note With LED_BUFFER_FORMAT_RGB the white component of RGBW strips is set to zero,
+ *       with LED_BUFFER_FORMAT_RGBW the white component is dropped on RGB strips
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel to set
+ * @param count: number of pixels to set
+ * @param buffer: pixel data, 3 (RGB) or 4 (RGBW) bytes per pixel depending on format
+ * @param format: layout of the pixel data in buffer
+ *
+ * @return
+ *      - ESP_OK: Set the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Set the pixels failed because of invalid parameters
+ *      - ESP_FAIL: Set the pixels failed because other error occurred
+ */
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *buffer, led_buffer_format_t format);
+
 /**
  * @brief Refresh memory colors to LEDs
  *
@@ -64,6 +86,28 @@ esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uin
  */
 esp_err_t led_strip_refresh(led_strip_handle_t strip);
 
+/**
+ * @brief Send pixels to the LEDs straight from source data, e.g. DMX slots
+ *
+ * The source is transformed while it is encoded for the strip, without going through the pixel buffer.
+ * The pixel buffer is left as it was, a later `led_strip_refresh` sends its contents again.
+ *
+ * @note With the RMT backend the source is read while the pixels are sent out. With `flags.async_refresh`
+ *       it must stay unchanged until the refresh is done, i.e. until the next refresh of the strip returns.
+ * @note LEDs past count are not sent anything and keep their color
+ *
+ * @param strip: LED strip
+ * @param data: source pixels, `count * transform->stride` bytes
+ * @param count: number of pixels, at most the length of the strip
+ * @param transform: how to read the source pixels
+ *
+ * @return
+ *      - ESP_OK: Refresh successfully
+ *      - ESP_ERR_INVALID_ARG: Refresh failed because of invalid parameters
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_refresh_from(led_strip_handle_t strip, const uint8_t *data, uint32_t count, const led_strip_transform_t *transform);
+
 /**
  * @brief Clear LED strip (turn off all LEDs)
  *
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2026 boomstick contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/spi_master.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief LED Strip APA102 / SK9822 specific configuration
+ */
+typedef struct {
+    spi_clock_source_t clk_src; /*!< SPI clock source */
+    spi_host_device_t spi_bus;  /*!< SPI bus ID. Which buses are available depends on the specific chip */
+    int clk_gpio_num;           /*!< GPIO of the clock line, the data line is `strip_gpio_num` of the LED strip configuration */
+    uint32_t clock_speed_hz;    /*!< SPI clock, if set to zero, a default clock (10MHz) will be applied */
+    led_strip_refresh_done_cb_t on_refresh_done; /*!< Called when a refresh is done, can be NULL. Runs in the SPI
+                                                      interrupt, see `led_strip_refresh_done_cb_t` about IRAM */
+    void *user_ctx;             /*!< User context passed to on_refresh_done */
+    struct {
+        uint32_t with_dma: 1;   /*!< Use DMA to transmit data, without it a refresh can only carry a few LEDs */
+        uint32_t async_refresh: 1; /*!< `led_strip_refresh` returns as soon as the transfer is queued.
+                                        Two frame buffers are used, so the next frame can be encoded while the
+                                        current one is on the wire */
+    } flags;
+} led_strip_apa102_config_t;
+
+/**
+ * @brief Create LED strip of clocked APA102 or SK9822 LEDs driven by the MOSI and SCLK lines of an SPI bus
+ *
+ * Every LED takes 32 bits: a 5 bit global brightness and 8 bits of blue, green and red, so a frame is sent
+ * several times faster than to single wire LEDs of the same length. Colors set through the pixel buffer get
+ * full brightness. `led_strip_refresh_from` with a `gamma16` transform instead picks for every LED the lowest
+ * brightness its brightest channel fits in, which gives dim colors up to 5 more bits of resolution.
+ * The dither state of the transform is not used.
+ *
+ * @note `led_model` must be LED_MODEL_APA102 or LED_MODEL_SK9822 and `led_pixel_format` LED_PIXEL_FORMAT_GRB,
+ *       the color order on the wire is taken care of. `flags.invert_out` is not supported.
+ * @note The whole SPI bus can't be used for other purposes.
+ *
+ * @param led_config LED strip configuration
+ * @param apa102_config APA102 specific configuration
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_NOT_SUPPORTED: create LED strip handle failed because of unsupported configuration
+ *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
+ *      - ESP_FAIL: create LED strip handle failed because some other error
+ */
+esp_err_t led_strip_new_apa102_device(const led_strip_config_t *led_config, const led_strip_apa102_config_t *apa102_config,
+                                      led_strip_handle_t *ret_strip);
+
+/**
+ * @brief Bytes sent for a refresh of count LEDs: start frame, LED frames and end frame
+ *
+ * @note Divided by the SPI clock this is how long the refresh takes on the wire
+ *
+ * @param count Number of LEDs refreshed
+ * @return Length of the refresh in bytes
+ */
+uint32_t led_strip_apa102_frame_bytes(uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -21,8 +21,14 @@ typedef struct {
     rmt_clock_source_t clk_src; /*!< RMT clock source */
     uint32_t resolution_hz;     /*!< RMT tick resolution, if set to zero, a default resolution (10MHz) will be applied */
     size_t mem_block_symbols;   /*!< How many RMT symbols can one RMT channel hold at one time. Set to 0 will fallback to use the default size. */
+    led_strip_refresh_done_cb_t on_refresh_done; /*!< Called when a refresh is done, can be NULL */
+    void *user_ctx;             /*!< User context passed to on_refresh_done */
     struct {
         uint32_t with_dma: 1;   /*!< Use DMA to transmit data */
+        uint32_t async_refresh: 1; /*!< `led_strip_refresh` returns as soon as the transmit is queued.
+                                        Two pixel buffers are used, so the next frame can be set while the
+                                        current one is on the wire. The RMT channel stays enabled, holding
+                                        its power management lock, for the lifetime of the strip. */
     } flags;
 } led_strip_rmt_config_t;
 
@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2026 boomstick contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Transform source pixels into the byte order sent to the strip, GRB or GRBW
+ *
+ * @note This is what `led_strip_refresh_from` does on the fly, it has no hardware dependencies
+ *
+ * @param transform: how to read the source pixels
+ * @param src: source data of the whole strip
+ * @param first: index of the first pixel to transform, also used for indexing the dither state
+ * @param count: number of pixels
+ * @param dst: output, `count * bytes_per_pixel` bytes
+ * @param bytes_per_pixel: 3 for GRB, 4 for GRBW output
+ */
+void led_strip_transform_pixels(const led_strip_transform_t *transform, const uint8_t *src, uint32_t first, uint32_t count,
+                                uint8_t *dst, uint8_t bytes_per_pixel);
+
+/**
+ * @brief Transform source pixels into 16 bit levels in the byte order sent to the strip, GRB or GRBW
+ *
+ * Same as `led_strip_transform_pixels`, but the levels are not rounded to 8 bits, for backends that can
+ * make use of the extra resolution. Without `gamma16` the 8 bit result is scaled to 16 bits.
+ * The dither state is neither used nor updated.
+ *
+ * @param transform: how to read the source pixels
+ * @param src: source data of the whole strip
+ * @param first: index of the first pixel to transform
+ * @param count: number of pixels
+ * @param dst: output, `count * channels` levels
+ * @param channels: 3 for GRB, 4 for GRBW output
+ */
+void led_strip_transform_levels(const led_strip_transform_t *transform, const uint8_t *src, uint32_t first, uint32_t count,
+                                uint16_t *dst, uint8_t channels);
+
+/**
+ * @brief Check that the channel offsets of a transform are within its stride
+ *
+ * @return true if the transform is usable
+ */
+bool led_strip_transform_valid(const led_strip_transform_t *transform);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -20,6 +21,40 @@ typedef enum {
     LED_PIXEL_FORMAT_INVALID /*!< Invalid pixel format */
 } led_pixel_format_t;
 
+/**
+ * @brief Layout of a pixel buffer passed to `led_strip_set_pixels`
+ */
+typedef enum {
+    LED_BUFFER_FORMAT_RGB,    /*!< 3 bytes per pixel: R, G, B */
+    LED_BUFFER_FORMAT_RGBW,   /*!< 4 bytes per pixel: R, G, B, W */
+    LED_BUFFER_FORMAT_INVALID /*!< Invalid buffer format */
+} led_buffer_format_t;
+
+/**
+ * @brief How `led_strip_refresh_from` turns source data into pixels
+ *
+ * Every source pixel is `stride` bytes, the color channels are read from the given offsets.
+ * The color is scaled by the intensity channel, if any, and then mapped through the gamma table, if any.
+ *
+ * With `gamma16` the colors and the intensity are instead mapped to 16 bits and multiplied at that
+ * resolution. The result is rounded to 8 bits, or with `dither` the dropped low byte is carried over
+ * to the next refresh of the pixel, so dim levels between two 8 bit steps show up on average when
+ * the strip is refreshed often enough.
+ */
+typedef struct {
+    uint8_t stride;       /*!< Bytes per source pixel */
+    uint8_t red;          /*!< Offset of the red channel in a source pixel */
+    uint8_t green;        /*!< Offset of the green channel in a source pixel */
+    uint8_t blue;         /*!< Offset of the blue channel in a source pixel */
+    int8_t white;         /*!< Offset of the white channel, -1 if the source has none */
+    int8_t intensity;     /*!< Offset of the intensity channel scaling the colors, -1 if the source has none */
+    const uint8_t *gamma; /*!< 256 entry table applied to every channel after intensity, NULL for none */
+    const uint16_t *gamma16; /*!< 256 entry table to 16 bits applied to every channel and the intensity, NULL for none.
+                                  Takes precedence over gamma */
+    uint8_t *dither;      /*!< Error carried over between refreshes, one byte per output byte of the strip
+                               (`max_leds * bytes per pixel`), zero initialized. NULL for no dithering, only used with gamma16 */
+} led_strip_transform_t;
+
 /**
  * @brief LED strip model
  * @note Different led model may have different timing parameters, so we need to distinguish them.
@@ -27,6 +62,8 @@ typedef enum {
 typedef enum {
     LED_MODEL_WS2812, /*!< LED strip model: WS2812 */
     LED_MODEL_SK6812, /*!< LED strip model: SK6812 */
+    LED_MODEL_APA102, /*!< LED strip model: APA102, clocked, see `led_strip_new_apa102_device` */
+    LED_MODEL_SK9822, /*!< LED strip model: SK9822, clocked, see `led_strip_new_apa102_device` */
     LED_MODEL_INVALID /*!< Invalid LED strip model */
 } led_model_t;
 
@@ -35,6 +72,20 @@ typedef enum {
  */
 typedef struct led_strip_t *led_strip_handle_t;
 
+/**
+ * @brief Callback invoked when the pixels of a refresh have been sent out
+ *
+ * @note Runs in ISR context, must not block
+ * @note The APA102 backend calls it from the SPI interrupt, which runs with the flash cache disabled when
+ *       CONFIG_SPI_MASTER_ISR_IN_IRAM is set (the default). The callback must then be placed in IRAM with
+ *       `IRAM_ATTR` and only touch IRAM-safe functions and data in internal RAM.
+ *
+ * @param strip LED strip that finished the refresh
+ * @param user_ctx User context given in the backend configuration
+ * @return Whether a high priority task has been woken up by this callback
+ */
+typedef bool (*led_strip_refresh_done_cb_t)(led_strip_handle_t strip, void *user_ctx);
+
 /**
  * @brief LED Strip Configuration
  */
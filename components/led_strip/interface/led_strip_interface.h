@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include "esp_err.h"
+#include "led_strip_types.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,22 @@ struct led_strip_t {
      */
     esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
 
+    /**
+     * @brief Set a range of consecutive pixels from a buffer
+     *
+     * @param strip: LED strip
+     * @param start: index of the first pixel to set
+     * @param count: number of pixels to set
+     * @param buffer: pixel data, laid out as described by format
+     * @param format: layout of the pixel data in buffer
+     *
+     * @return
+     *      - ESP_OK: Set the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Set the pixels failed because of invalid parameters
+     *      - ESP_FAIL: Set the pixels failed because other error occurred
+     */
+    esp_err_t (*set_pixels)(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *buffer, led_buffer_format_t format);
+
     /**
      * @brief Refresh memory colors to LEDs
      *
@@ -66,6 +83,21 @@ struct led_strip_t {
      */
     esp_err_t (*refresh)(led_strip_t *strip);
 
+    /**
+     * @brief Send pixels to the LEDs straight from source data
+     *
+     * @param strip: LED strip
+     * @param data: source pixels
+     * @param count: number of pixels
+     * @param transform: how to read the source pixels, already checked to be valid
+     *
+     * @return
+     *      - ESP_OK: Refresh successfully
+     *      - ESP_ERR_INVALID_ARG: Refresh failed because of invalid parameters
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     */
+    esp_err_t (*refresh_from)(led_strip_t *strip, const uint8_t *data, uint32_t count, const led_strip_transform_t *transform);
+
     /**
      * @brief Clear LED strip (turn off all LEDs)
      *
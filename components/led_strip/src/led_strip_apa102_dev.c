@@ -0,0 +1,316 @@
+/*
+ * SPDX-FileCopyrightText: 2026 boomstick contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+
+#define LED_STRIP_APA102_DEFAULT_CLOCK (10 * 1000 * 1000) // 10MHz
+#define LED_STRIP_APA102_TRANS_QUEUE_SIZE 1
+
+#define APA102_START_FRAME_BYTES 4
+#define APA102_BYTES_PER_LED 4
+// First byte of every LED, three ones and the 5 bit global brightness
+#define APA102_LED_HEADER 0xe0
+#define APA102_MAX_BRIGHTNESS 31
+#define APA102_TRANSFORM_CHUNK_PIXELS 16
+
+static const char *TAG = "led_strip_apa102";
+
+typedef struct {
+    led_strip_t base;
+    spi_host_device_t spi_host;
+    spi_device_handle_t spi_device;
+    uint32_t strip_len;
+    bool async_refresh;
+    bool in_flight;             // a queued transfer has not been waited for (async refresh only)
+    spi_transaction_t trans;
+    led_strip_refresh_done_cb_t on_refresh_done;
+    void *user_ctx;
+    uint8_t *frame_mem;         // one frame, or two with async refresh
+    uint8_t *frame;             // frame the next refresh is encoded into
+    uint8_t pixel_buf[];        // LED frames the set_pixel functions write to
+} led_strip_apa102_obj;
+
+/*
+ * The data is shifted through the strip, every LED passing it on half a clock late, so the
+ * end frame has to provide at least half a clock per LED for it to reach the last one.
+ * Zeros are used, so LEDs past the end never take the end frame for a color. SK9822 latches
+ * the colors on 32 zero bits, which the end frame always starts with.
+ */
+static inline uint32_t apa102_end_frame_bytes(uint32_t count)
+{
+    return 4 + (count + 15) / 16;
+}
+
+uint32_t led_strip_apa102_frame_bytes(uint32_t count)
+{
+    return APA102_START_FRAME_BYTES + count * APA102_BYTES_PER_LED + apa102_end_frame_bytes(count);
+}
+
+// Room for one frame in frame_mem, rounded up so the second frame starts word aligned for DMA
+static inline size_t apa102_frame_stride(uint32_t count)
+{
+    return (led_strip_apa102_frame_bytes(count) + 3) & ~(size_t) 3;
+}
+
+static inline void apa102_set_led(uint8_t *led, uint32_t brightness, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led[0] = APA102_LED_HEADER | brightness;
+    led[1] = blue;
+    led[2] = green;
+    led[3] = red;
+}
+
+/*
+ * Encode 16 bit GRB levels with the lowest brightness the brightest channel fits in at 8 bits,
+ * so dim colors keep their resolution.
+ */
+static inline void apa102_set_led16(uint8_t *led, const uint16_t *grb)
+{
+    uint32_t max = grb[0] > grb[1] ? grb[0] : grb[1];
+    max = grb[2] > max ? grb[2] : max;
+    uint32_t brightness = (max * APA102_MAX_BRIGHTNESS + 0xfffe) / 0xffff;
+    if (brightness == 0) {
+        apa102_set_led(led, 0, 0, 0, 0);
+        return;
+    }
+    // A color step at this brightness is brightness * 257 / 31 in 16 bit levels, as a 16.16 reciprocal
+    uint32_t scale = ((APA102_MAX_BRIGHTNESS << 16) + brightness * 257 / 2) / (brightness * 257);
+    uint32_t color[3];
+    for (int c = 0; c < 3; c++) {
+        color[c] = (grb[c] * scale + 0x8000) >> 16;
+        color[c] = color[c] > 0xff ? 0xff : color[c];
+    }
+    apa102_set_led(led, brightness, color[1], color[0], color[2]);
+}
+
+static esp_err_t led_strip_apa102_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    ESP_RETURN_ON_FALSE(index < apa102_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    apa102_set_led(&apa102_strip->pixel_buf[index * APA102_BYTES_PER_LED], APA102_MAX_BRIGHTNESS, red & 0xFF, green & 0xFF, blue & 0xFF);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    ESP_LOGE(TAG, "APA102 and SK9822 have no white component");
+    return ESP_ERR_INVALID_ARG;
+}
+
+static esp_err_t led_strip_apa102_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *buffer, led_buffer_format_t format)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    ESP_RETURN_ON_FALSE(start <= apa102_strip->strip_len && count <= apa102_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint8_t *buf = apa102_strip->pixel_buf + start * APA102_BYTES_PER_LED;
+    uint8_t in_stride = format == LED_BUFFER_FORMAT_RGBW ? 4 : 3;
+    for (uint32_t i = 0; i < count; i++, buf += APA102_BYTES_PER_LED, buffer += in_stride) {
+        apa102_set_led(buf, APA102_MAX_BRIGHTNESS, buffer[0], buffer[1], buffer[2]);
+    }
+    return ESP_OK;
+}
+
+// Called from the SPI interrupt once a frame is out
+static void IRAM_ATTR led_strip_apa102_trans_done(spi_transaction_t *trans)
+{
+    led_strip_apa102_obj *apa102_strip = trans->user;
+    if (apa102_strip->on_refresh_done && apa102_strip->on_refresh_done(&apa102_strip->base, apa102_strip->user_ctx)) {
+        portYIELD_FROM_ISR(pdTRUE);
+    }
+}
+
+// Wait for the transfer queued by the previous async refresh
+static esp_err_t led_strip_apa102_wait(led_strip_apa102_obj *apa102_strip)
+{
+    if (!apa102_strip->in_flight) {
+        return ESP_OK;
+    }
+    spi_transaction_t *done;
+    apa102_strip->in_flight = false;
+    return spi_device_get_trans_result(apa102_strip->spi_device, &done, portMAX_DELAY);
+}
+
+// Send the first count LEDs of the frame, which has been encoded up to them
+static esp_err_t led_strip_apa102_send(led_strip_apa102_obj *apa102_strip, uint32_t count)
+{
+    uint8_t *frame = apa102_strip->frame;
+    memset(frame + APA102_START_FRAME_BYTES + count * APA102_BYTES_PER_LED, 0, apa102_end_frame_bytes(count));
+    ESP_RETURN_ON_ERROR(led_strip_apa102_wait(apa102_strip), TAG, "wait for previous transfer failed");
+
+    spi_transaction_t *trans = &apa102_strip->trans;
+    memset(trans, 0, sizeof(*trans));
+    trans->length = led_strip_apa102_frame_bytes(count) * 8;
+    trans->tx_buffer = frame;
+    trans->user = apa102_strip;
+    if (!apa102_strip->async_refresh) {
+        ESP_RETURN_ON_ERROR(spi_device_transmit(apa102_strip->spi_device, trans), TAG, "transmit pixels by SPI failed");
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_ERROR(spi_device_queue_trans(apa102_strip->spi_device, trans, portMAX_DELAY), TAG, "queue pixels to SPI failed");
+    apa102_strip->in_flight = true;
+    // Encode the next frame into the other buffer while this one is on the wire
+    size_t frame_stride = apa102_frame_stride(apa102_strip->strip_len);
+    apa102_strip->frame = frame == apa102_strip->frame_mem ? apa102_strip->frame_mem + frame_stride : apa102_strip->frame_mem;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_refresh(led_strip_t *strip)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    memcpy(apa102_strip->frame + APA102_START_FRAME_BYTES, apa102_strip->pixel_buf, apa102_strip->strip_len * APA102_BYTES_PER_LED);
+    return led_strip_apa102_send(apa102_strip, apa102_strip->strip_len);
+}
+
+static esp_err_t led_strip_apa102_refresh_from(led_strip_t *strip, const uint8_t *data, uint32_t count, const led_strip_transform_t *transform)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    ESP_RETURN_ON_FALSE(count <= apa102_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    // Transform a few pixels at a time straight into the frame
+    uint8_t *buf = apa102_strip->frame + APA102_START_FRAME_BYTES;
+    for (uint32_t done = 0; done < count;) {
+        uint32_t n = count - done < APA102_TRANSFORM_CHUNK_PIXELS ? count - done : APA102_TRANSFORM_CHUNK_PIXELS;
+        if (transform->gamma16) {
+            uint16_t levels[APA102_TRANSFORM_CHUNK_PIXELS * 3];
+            led_strip_transform_levels(transform, data, done, n, levels, 3);
+            for (uint32_t i = 0; i < n; i++, buf += APA102_BYTES_PER_LED) {
+                apa102_set_led16(buf, &levels[i * 3]);
+            }
+        } else {
+            uint8_t pixels[APA102_TRANSFORM_CHUNK_PIXELS * 3];
+            led_strip_transform_pixels(transform, data, done, n, pixels, 3);
+            for (uint32_t i = 0; i < n; i++, buf += APA102_BYTES_PER_LED) {
+                // GRB from the transform
+                apa102_set_led(buf, APA102_MAX_BRIGHTNESS, pixels[i * 3 + 1], pixels[i * 3], pixels[i * 3 + 2]);
+            }
+        }
+        done += n;
+    }
+    return led_strip_apa102_send(apa102_strip, count);
+}
+
+static esp_err_t led_strip_apa102_clear(led_strip_t *strip)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    for (uint32_t i = 0; i < apa102_strip->strip_len; i++) {
+        apa102_set_led(&apa102_strip->pixel_buf[i * APA102_BYTES_PER_LED], APA102_MAX_BRIGHTNESS, 0, 0, 0);
+    }
+    return led_strip_apa102_refresh(strip);
+}
+
+static esp_err_t led_strip_apa102_del(led_strip_t *strip)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+
+    ESP_RETURN_ON_ERROR(led_strip_apa102_wait(apa102_strip), TAG, "wait for last transfer failed");
+    ESP_RETURN_ON_ERROR(spi_bus_remove_device(apa102_strip->spi_device), TAG, "delete spi device failed");
+    ESP_RETURN_ON_ERROR(spi_bus_free(apa102_strip->spi_host), TAG, "free spi bus failed");
+
+    free(apa102_strip->frame_mem);
+    free(apa102_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_apa102_device(const led_strip_config_t *led_config, const led_strip_apa102_config_t *apa102_config,
+                                      led_strip_handle_t *ret_strip)
+{
+    led_strip_apa102_obj *apa102_strip = NULL;
+    bool bus_initialized = false;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && apa102_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->led_model == LED_MODEL_APA102 || led_config->led_model == LED_MODEL_SK9822,
+                      ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    ESP_GOTO_ON_FALSE(led_config->led_pixel_format == LED_PIXEL_FORMAT_GRB, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
+    ESP_GOTO_ON_FALSE(!led_config->flags.invert_out, ESP_ERR_NOT_SUPPORTED, err, TAG, "inverted output not supported");
+
+    apa102_strip = calloc(1, sizeof(led_strip_apa102_obj) + led_config->max_leds * APA102_BYTES_PER_LED);
+    ESP_GOTO_ON_FALSE(apa102_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for apa102 strip");
+    uint32_t mem_caps = MALLOC_CAP_DEFAULT;
+    if (apa102_config->flags.with_dma) {
+        // DMA buffer must be placed in internal SRAM
+        mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+    }
+    // The start frame stays zero, the rest is written on every refresh
+    size_t frame_size = led_strip_apa102_frame_bytes(led_config->max_leds);
+    apa102_strip->frame_mem = heap_caps_calloc(apa102_config->flags.async_refresh ? 2 : 1, apa102_frame_stride(led_config->max_leds), mem_caps);
+    ESP_GOTO_ON_FALSE(apa102_strip->frame_mem, ESP_ERR_NO_MEM, err, TAG, "no mem for apa102 frames");
+    apa102_strip->frame = apa102_strip->frame_mem;
+    for (uint32_t i = 0; i < led_config->max_leds; i++) {
+        apa102_set_led(&apa102_strip->pixel_buf[i * APA102_BYTES_PER_LED], APA102_MAX_BRIGHTNESS, 0, 0, 0);
+    }
+
+    apa102_strip->spi_host = apa102_config->spi_bus;
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    spi_clock_source_t clk_src = SPI_CLK_SRC_DEFAULT;
+    if (apa102_config->clk_src) {
+        clk_src = apa102_config->clk_src;
+    }
+
+    spi_bus_config_t spi_bus_cfg = {
+        .mosi_io_num = led_config->strip_gpio_num,
+        .sclk_io_num = apa102_config->clk_gpio_num,
+        //Only use MOSI and SCLK, set -1 when other pins are not used.
+        .miso_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = frame_size,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_initialize(apa102_strip->spi_host, &spi_bus_cfg, apa102_config->flags.with_dma ? SPI_DMA_CH_AUTO : SPI_DMA_DISABLED),
+                      err, TAG, "create SPI bus failed");
+    bus_initialized = true;
+
+    spi_device_interface_config_t spi_dev_cfg = {
+        .clock_source = clk_src,
+        .command_bits = 0,
+        .address_bits = 0,
+        .dummy_bits = 0,
+        .clock_speed_hz = apa102_config->clock_speed_hz ? apa102_config->clock_speed_hz : LED_STRIP_APA102_DEFAULT_CLOCK,
+        // Data is sampled on the rising edge of the clock
+        .mode = 0,
+        //set -1 when CS is not used
+        .spics_io_num = -1,
+        .queue_size = LED_STRIP_APA102_TRANS_QUEUE_SIZE,
+        .post_cb = led_strip_apa102_trans_done,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_add_device(apa102_strip->spi_host, &spi_dev_cfg, &apa102_strip->spi_device), err, TAG, "Failed to add spi device");
+
+    int clock_khz = 0;
+    spi_device_get_actual_freq(apa102_strip->spi_device, &clock_khz);
+    ESP_LOGD(TAG, "SPI clock %dKHz", clock_khz);
+
+    apa102_strip->on_refresh_done = apa102_config->on_refresh_done;
+    apa102_strip->user_ctx = apa102_config->user_ctx;
+    apa102_strip->async_refresh = apa102_config->flags.async_refresh;
+    apa102_strip->strip_len = led_config->max_leds;
+    apa102_strip->base.set_pixel = led_strip_apa102_set_pixel;
+    apa102_strip->base.set_pixel_rgbw = led_strip_apa102_set_pixel_rgbw;
+    apa102_strip->base.set_pixels = led_strip_apa102_set_pixels;
+    apa102_strip->base.refresh = led_strip_apa102_refresh;
+    apa102_strip->base.refresh_from = led_strip_apa102_refresh_from;
+    apa102_strip->base.clear = led_strip_apa102_clear;
+    apa102_strip->base.del = led_strip_apa102_del;
+
+    *ret_strip = &apa102_strip->base;
+    return ESP_OK;
+err:
+    if (apa102_strip) {
+        if (apa102_strip->spi_device) {
+            spi_bus_remove_device(apa102_strip->spi_device);
+        }
+        if (bus_initialized) {
+            spi_bus_free(apa102_strip->spi_host);
+        }
+        free(apa102_strip->frame_mem);
+        free(apa102_strip);
+    }
+    return ret;
+}
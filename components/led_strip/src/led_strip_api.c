@@ -22,12 +22,24 @@ esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uin
     return strip->set_pixel_rgbw(strip, index, red, green, blue, white);
 }
 
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *buffer, led_buffer_format_t format)
+{
+    ESP_RETURN_ON_FALSE(strip && buffer && format < LED_BUFFER_FORMAT_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixels(strip, start, count, buffer, format);
+}
+
 esp_err_t led_strip_refresh(led_strip_handle_t strip)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
     return strip->refresh(strip);
 }
 
+esp_err_t led_strip_refresh_from(led_strip_handle_t strip, const uint8_t *data, uint32_t count, const led_strip_transform_t *transform)
+{
+    ESP_RETURN_ON_FALSE(strip && data && led_strip_transform_valid(transform), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->refresh_from(strip, data, count, transform);
+}
+
 esp_err_t led_strip_clear(led_strip_handle_t strip)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
@@ -8,6 +8,8 @@
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "driver/rmt_tx.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
@@ -28,9 +30,15 @@ typedef struct {
     led_strip_t base;
     rmt_channel_handle_t rmt_chan;
     rmt_encoder_handle_t strip_encoder;
+    rmt_encoder_handle_t transform_encoder; // encodes straight from the source given to refresh_from
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
-    uint8_t pixel_buf[];
+    bool async_refresh;
+    SemaphoreHandle_t tx_buf_free; // given when the buffer on the wire has been sent out (async refresh only)
+    led_strip_refresh_done_cb_t on_refresh_done;
+    void *user_ctx;
+    uint8_t *pixel_buf; // buffer the set_pixel functions write to
+    uint8_t pixel_mem[]; // one pixel buffer, or two with async refresh
 } led_strip_rmt_obj;
 
 static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
@@ -62,21 +70,114 @@ static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     return ESP_OK;
 }
 
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *buffer, led_buffer_format_t format)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(start <= rmt_strip->strip_len && count <= rmt_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint8_t *buf = rmt_strip->pixel_buf + start * rmt_strip->bytes_per_pixel;
+    const uint8_t *end = buf + count * rmt_strip->bytes_per_pixel;
+    // Reorder into GRB(W), as LED strip like WS2812 sends out pixels in this order
+    if (rmt_strip->bytes_per_pixel == 3) {
+        uint8_t in_stride = format == LED_BUFFER_FORMAT_RGBW ? 4 : 3;
+        for (; buf < end; buf += 3, buffer += in_stride) {
+            buf[0] = buffer[1];
+            buf[1] = buffer[0];
+            buf[2] = buffer[2];
+        }
+    } else if (format == LED_BUFFER_FORMAT_RGBW) {
+        for (; buf < end; buf += 4, buffer += 4) {
+            buf[0] = buffer[1];
+            buf[1] = buffer[0];
+            buf[2] = buffer[2];
+            buf[3] = buffer[3];
+        }
+    } else {
+        for (; buf < end; buf += 4, buffer += 3) {
+            buf[0] = buffer[1];
+            buf[1] = buffer[0];
+            buf[2] = buffer[2];
+            buf[3] = 0;
+        }
+    }
+    return ESP_OK;
+}
+
 static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
     rmt_transmit_config_t tx_conf = {
         .loop_count = 0,
     };
+    size_t buf_size = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+
+    if (rmt_strip->async_refresh) {
+        // The other buffer must be off the wire before it can be drawn to
+        xSemaphoreTake(rmt_strip->tx_buf_free, portMAX_DELAY);
+        esp_err_t ret = rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, rmt_strip->pixel_buf, buf_size, &tx_conf);
+        if (ret != ESP_OK) {
+            xSemaphoreGive(rmt_strip->tx_buf_free);
+            ESP_LOGE(TAG, "transmit pixels by RMT failed");
+            return ret;
+        }
+        // Continue drawing on the other buffer, starting from the frame just queued
+        uint8_t *next_buf = rmt_strip->pixel_buf == rmt_strip->pixel_mem ? rmt_strip->pixel_mem + buf_size : rmt_strip->pixel_mem;
+        memcpy(next_buf, rmt_strip->pixel_buf, buf_size);
+        rmt_strip->pixel_buf = next_buf;
+        return ESP_OK;
+    }
 
     ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
     ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, rmt_strip->pixel_buf,
-                                     rmt_strip->strip_len * rmt_strip->bytes_per_pixel, &tx_conf), TAG, "transmit pixels by RMT failed");
+                                     buf_size, &tx_conf), TAG, "transmit pixels by RMT failed");
+    ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh_from(led_strip_t *strip, const uint8_t *data, uint32_t count, const led_strip_transform_t *transform)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(count <= rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    rmt_transmit_config_t tx_conf = {
+        .loop_count = 0,
+    };
+
+    if (rmt_strip->async_refresh) {
+        // The previous transmit must be done before the encoder can be set up again
+        xSemaphoreTake(rmt_strip->tx_buf_free, portMAX_DELAY);
+        rmt_led_strip_transform_encoder_set(rmt_strip->transform_encoder, transform);
+        esp_err_t ret = rmt_transmit(rmt_strip->rmt_chan, rmt_strip->transform_encoder, data, count * transform->stride, &tx_conf);
+        if (ret != ESP_OK) {
+            xSemaphoreGive(rmt_strip->tx_buf_free);
+            ESP_LOGE(TAG, "transmit pixels by RMT failed");
+            return ret;
+        }
+        return ESP_OK;
+    }
+
+    rmt_led_strip_transform_encoder_set(rmt_strip->transform_encoder, transform);
+    ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->transform_encoder, data,
+                                     count * transform->stride, &tx_conf), TAG, "transmit pixels by RMT failed");
     ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
     ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
     return ESP_OK;
 }
 
+static bool led_strip_rmt_tx_done(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = user_ctx;
+    BaseType_t task_woken = pdFALSE;
+    bool cb_woken = false;
+    if (rmt_strip->async_refresh) {
+        xSemaphoreGiveFromISR(rmt_strip->tx_buf_free, &task_woken);
+    }
+    if (rmt_strip->on_refresh_done) {
+        cb_woken = rmt_strip->on_refresh_done(&rmt_strip->base, rmt_strip->user_ctx);
+    }
+    return task_woken == pdTRUE || cb_woken;
+}
+
 static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -88,8 +189,14 @@ static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
 static esp_err_t led_strip_rmt_del(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (rmt_strip->async_refresh) {
+        ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+        ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+        vSemaphoreDelete(rmt_strip->tx_buf_free);
+    }
     ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
     ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
+    ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->transform_encoder), TAG, "delete transform encoder failed");
     free(rmt_strip);
     return ESP_OK;
 }
@@ -108,8 +215,10 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     } else {
         assert(false);
     }
-    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + led_config->max_leds * bytes_per_pixel);
+    int buf_count = rmt_config->flags.async_refresh ? 2 : 1;
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + buf_count * led_config->max_leds * bytes_per_pixel);
     ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    rmt_strip->pixel_buf = rmt_strip->pixel_mem;
     uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
 
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -138,13 +247,34 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
         .led_model = led_config->led_model
     };
     ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
+    ESP_GOTO_ON_ERROR(rmt_new_led_strip_transform_encoder(&strip_encoder_conf, bytes_per_pixel, &rmt_strip->transform_encoder),
+                      err, TAG, "create LED strip transform encoder failed");
+
+    rmt_strip->on_refresh_done = rmt_config->on_refresh_done;
+    rmt_strip->user_ctx = rmt_config->user_ctx;
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = led_strip_rmt_tx_done,
+    };
+    ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_strip->rmt_chan, &cbs, rmt_strip), err, TAG, "register RMT callbacks failed");
+
+    if (rmt_config->flags.async_refresh) {
+        rmt_strip->tx_buf_free = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(rmt_strip->tx_buf_free, ESP_ERR_NO_MEM, err, TAG, "no mem for tx semaphore");
+        // Nothing is on the wire yet
+        xSemaphoreGive(rmt_strip->tx_buf_free);
+        // Keep the channel enabled, so refresh only has to queue the transmit
+        ESP_GOTO_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), err, TAG, "enable RMT channel failed");
+        rmt_strip->async_refresh = true;
+    }
 
 
     rmt_strip->bytes_per_pixel = bytes_per_pixel;
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
     rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
+    rmt_strip->base.refresh_from = led_strip_rmt_refresh_from;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
 
@@ -158,6 +288,12 @@ err:
         if (rmt_strip->strip_encoder) {
             rmt_del_encoder(rmt_strip->strip_encoder);
         }
+        if (rmt_strip->transform_encoder) {
+            rmt_del_encoder(rmt_strip->transform_encoder);
+        }
+        if (rmt_strip->tx_buf_free) {
+            vSemaphoreDelete(rmt_strip->tx_buf_free);
+        }
         free(rmt_strip);
     }
     return ret;
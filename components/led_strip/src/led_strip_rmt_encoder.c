@@ -6,6 +6,7 @@
 
 #include "esp_check.h"
 #include "led_strip_rmt_encoder.h"
+#include "led_strip_transform.h"
 
 static const char *TAG = "led_rmt_encoder";
 
@@ -71,17 +72,11 @@ static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
     return ESP_OK;
 }
 
-esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+// Create the bytes encoder with the bit timing of the led model and the copy encoder for the reset code
+static esp_err_t led_strip_new_sub_encoders(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *bytes_encoder,
+                                            rmt_encoder_handle_t *copy_encoder, rmt_symbol_word_t *reset_code)
 {
     esp_err_t ret = ESP_OK;
-    rmt_led_strip_encoder_t *led_encoder = NULL;
-    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
-    ESP_GOTO_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
-    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
-    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
-    led_encoder->base.encode = rmt_encode_led_strip;
-    led_encoder->base.del = rmt_del_led_strip_encoder;
-    led_encoder->base.reset = rmt_led_strip_encoder_reset;
     rmt_bytes_encoder_config_t bytes_encoder_config;
     if (config->led_model == LED_MODEL_SK6812) {
         bytes_encoder_config = (rmt_bytes_encoder_config_t) {
@@ -119,28 +114,165 @@ esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rm
     } else {
         assert(false);
     }
-    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create bytes encoder failed");
+    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, bytes_encoder), err, TAG, "create bytes encoder failed");
     rmt_copy_encoder_config_t copy_encoder_config = {};
-    ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder), err, TAG, "create copy encoder failed");
+    ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, copy_encoder), err, TAG, "create copy encoder failed");
 
     uint32_t reset_ticks = config->resolution / 1000000 * 50 / 2; // reset code duration defaults to 50us
-    led_encoder->reset_code = (rmt_symbol_word_t) {
+    *reset_code = (rmt_symbol_word_t) {
         .level0 = 0,
         .duration0 = reset_ticks,
         .level1 = 0,
         .duration1 = reset_ticks,
     };
+    return ESP_OK;
+err:
+    if (*bytes_encoder) {
+        rmt_del_encoder(*bytes_encoder);
+        *bytes_encoder = NULL;
+    }
+    return ret;
+}
+
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->led_model == LED_MODEL_WS2812 || config->led_model == LED_MODEL_SK6812, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    led_encoder->base.encode = rmt_encode_led_strip;
+    led_encoder->base.del = rmt_del_led_strip_encoder;
+    led_encoder->base.reset = rmt_led_strip_encoder_reset;
+    ESP_GOTO_ON_ERROR(led_strip_new_sub_encoders(config, &led_encoder->bytes_encoder, &led_encoder->copy_encoder,
+                                                 &led_encoder->reset_code), err, TAG, "create sub encoders failed");
     *ret_encoder = &led_encoder->base;
     return ESP_OK;
 err:
-    if (led_encoder) {
-        if (led_encoder->bytes_encoder) {
-            rmt_del_encoder(led_encoder->bytes_encoder);
+    free(led_encoder);
+    return ret;
+}
+
+/*
+ * The transform encoder reads the source pixels given to rmt_transmit, transforms a chunk of them
+ * at a time into a small buffer and feeds that to the bytes encoder. The bytes encoder resumes from
+ * where it ran out of channel memory as long as it is given the same chunk again, so a chunk is only
+ * transformed once.
+ */
+#define LED_STRIP_TRANSFORM_CHUNK_PIXELS 16
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *copy_encoder;
+    int state;
+    rmt_symbol_word_t reset_code;
+    led_strip_transform_t transform;
+    uint8_t bytes_per_pixel;
+    uint32_t next_pixel; // first source pixel not transformed yet
+    size_t chunk_len;    // bytes in chunk still being encoded, 0 if the next chunk is due
+    uint8_t chunk[LED_STRIP_TRANSFORM_CHUNK_PIXELS * 4];
+} rmt_led_strip_transform_encoder_t;
+
+static size_t rmt_encode_led_strip_transform(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_led_strip_transform_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_transform_encoder_t, base);
+    rmt_encoder_handle_t bytes_encoder = led_encoder->bytes_encoder;
+    rmt_encoder_handle_t copy_encoder = led_encoder->copy_encoder;
+    const led_strip_transform_t *transform = &led_encoder->transform;
+    uint32_t pixels = data_size / transform->stride;
+    rmt_encode_state_t session_state = 0;
+    rmt_encode_state_t state = 0;
+    size_t encoded_symbols = 0;
+    switch (led_encoder->state) {
+    case 0: // send pixel data
+        while (1) {
+            if (!led_encoder->chunk_len) {
+                if (led_encoder->next_pixel >= pixels) {
+                    led_encoder->state = 1; // all pixels sent
+                    break;
+                }
+                uint32_t count = pixels - led_encoder->next_pixel;
+                if (count > LED_STRIP_TRANSFORM_CHUNK_PIXELS) {
+                    count = LED_STRIP_TRANSFORM_CHUNK_PIXELS;
+                }
+                led_strip_transform_pixels(transform, primary_data, led_encoder->next_pixel, count,
+                                           led_encoder->chunk, led_encoder->bytes_per_pixel);
+                led_encoder->next_pixel += count;
+                led_encoder->chunk_len = count * led_encoder->bytes_per_pixel;
+            }
+            encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, led_encoder->chunk, led_encoder->chunk_len, &session_state);
+            if (session_state & RMT_ENCODING_COMPLETE) {
+                led_encoder->chunk_len = 0; // move on to the next chunk
+            }
+            if (session_state & RMT_ENCODING_MEM_FULL) {
+                state |= RMT_ENCODING_MEM_FULL;
+                goto out; // yield if there's no free space for encoding artifacts
+            }
         }
-        if (led_encoder->copy_encoder) {
-            rmt_del_encoder(led_encoder->copy_encoder);
+    // fall-through
+    case 1: // send reset code
+        encoded_symbols += copy_encoder->encode(copy_encoder, channel, &led_encoder->reset_code,
+                                                sizeof(led_encoder->reset_code), &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            led_encoder->state = 0; // back to the initial encoding session
+            led_encoder->next_pixel = 0;
+            state |= RMT_ENCODING_COMPLETE;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out; // yield if there's no free space for encoding artifacts
         }
-        free(led_encoder);
     }
+out:
+    *ret_state = state;
+    return encoded_symbols;
+}
+
+static esp_err_t rmt_del_led_strip_transform_encoder(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_transform_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_transform_encoder_t, base);
+    rmt_del_encoder(led_encoder->bytes_encoder);
+    rmt_del_encoder(led_encoder->copy_encoder);
+    free(led_encoder);
+    return ESP_OK;
+}
+
+static esp_err_t rmt_led_strip_transform_encoder_reset(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_transform_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_transform_encoder_t, base);
+    rmt_encoder_reset(led_encoder->bytes_encoder);
+    rmt_encoder_reset(led_encoder->copy_encoder);
+    led_encoder->state = 0;
+    led_encoder->next_pixel = 0;
+    led_encoder->chunk_len = 0;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_led_strip_transform_encoder(const led_strip_encoder_config_t *config, uint8_t bytes_per_pixel, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_transform_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder && bytes_per_pixel >= 3 && bytes_per_pixel <= 4, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->led_model == LED_MODEL_WS2812 || config->led_model == LED_MODEL_SK6812, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    led_encoder = calloc(1, sizeof(rmt_led_strip_transform_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip transform encoder");
+    led_encoder->base.encode = rmt_encode_led_strip_transform;
+    led_encoder->base.del = rmt_del_led_strip_transform_encoder;
+    led_encoder->base.reset = rmt_led_strip_transform_encoder_reset;
+    led_encoder->bytes_per_pixel = bytes_per_pixel;
+    ESP_GOTO_ON_ERROR(led_strip_new_sub_encoders(config, &led_encoder->bytes_encoder, &led_encoder->copy_encoder,
+                                                 &led_encoder->reset_code), err, TAG, "create sub encoders failed");
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    free(led_encoder);
     return ret;
 }
+
+void rmt_led_strip_transform_encoder_set(rmt_encoder_handle_t encoder, const led_strip_transform_t *transform)
+{
+    rmt_led_strip_transform_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_transform_encoder_t, base);
+    led_encoder->transform = *transform;
+}
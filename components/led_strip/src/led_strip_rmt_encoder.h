@@ -33,6 +33,28 @@ typedef struct {
  */
 esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
 
+/**
+ * @brief Create RMT encoder for encoding source pixels into RMT symbols, transforming them on the way
+ *
+ * @note The transmitted data is the source pixels, read as set by `rmt_led_strip_transform_encoder_set`
+ *
+ * @param[in] config Encoder configuration
+ * @param[in] bytes_per_pixel Bytes per pixel sent to the strip, 3 (GRB) or 4 (GRBW)
+ * @param[out] ret_encoder Returned encoder handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating led strip encoder
+ *      - ESP_OK if creating encoder successfully
+ */
+esp_err_t rmt_new_led_strip_transform_encoder(const led_strip_encoder_config_t *config, uint8_t bytes_per_pixel, rmt_encoder_handle_t *ret_encoder);
+
+/**
+ * @brief Set the transform used by the following transmits
+ *
+ * @note Must not be called while a transmit with the encoder is in progress
+ */
+void rmt_led_strip_transform_encoder_set(rmt_encoder_handle_t encoder, const led_strip_transform_t *transform);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@
 
 #define SPI_BYTES_PER_COLOR_BYTE 3
 #define SPI_BITS_PER_COLOR_BYTE (SPI_BYTES_PER_COLOR_BYTE * 8)
+#define SPI_TRANSFORM_CHUNK_PIXELS 16
 
 static const char *TAG = "led_strip_spi";
 
@@ -31,20 +32,35 @@ typedef struct {
     uint8_t pixel_buf[];
 } led_strip_spi_obj;
 
-// please make sure to zero-initialize the buf before calling this function
-static void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
+// Each color of 1 bit is represented by 3 bits of SPI, low_level:100 ,high_level:110
+// So a color byte occupies 3 bytes of SPI, most significant bit first.
+#define SPI_CODE_BIT(data, n) ((((data) >> (n)) & 1 ? 0x6 : 0x4) << ((n) * 3))
+#define SPI_CODE(data) (SPI_CODE_BIT(data, 7) | SPI_CODE_BIT(data, 6) | SPI_CODE_BIT(data, 5) | SPI_CODE_BIT(data, 4) | \
+                        SPI_CODE_BIT(data, 3) | SPI_CODE_BIT(data, 2) | SPI_CODE_BIT(data, 1) | SPI_CODE_BIT(data, 0))
+#define SPI_LUT_1(data) { (SPI_CODE(data) >> 16) & 0xff, (SPI_CODE(data) >> 8) & 0xff, SPI_CODE(data) & 0xff }
+#define SPI_LUT_4(data) SPI_LUT_1(data), SPI_LUT_1(data + 1), SPI_LUT_1(data + 2), SPI_LUT_1(data + 3)
+#define SPI_LUT_16(data) SPI_LUT_4(data), SPI_LUT_4(data + 4), SPI_LUT_4(data + 8), SPI_LUT_4(data + 12)
+#define SPI_LUT_64(data) SPI_LUT_16(data), SPI_LUT_16(data + 16), SPI_LUT_16(data + 32), SPI_LUT_16(data + 48)
+
+// SPI encoding of every color byte value, built at compile time
+static const uint8_t spi_lut[256][SPI_BYTES_PER_COLOR_BYTE] = {
+    SPI_LUT_64(0), SPI_LUT_64(64), SPI_LUT_64(128), SPI_LUT_64(192)
+};
+
+// Pre-encoded zero color bytes, copied over the pixel buffer on clear
+#define SPI_BLACK_1 (SPI_CODE(0) >> 16) & 0xff, (SPI_CODE(0) >> 8) & 0xff, SPI_CODE(0) & 0xff
+#define SPI_BLACK_4 SPI_BLACK_1, SPI_BLACK_1, SPI_BLACK_1, SPI_BLACK_1
+#define SPI_BLACK_BYTES (16 * SPI_BYTES_PER_COLOR_BYTE)
+static const uint8_t spi_black[SPI_BLACK_BYTES] = {
+    SPI_BLACK_4, SPI_BLACK_4, SPI_BLACK_4, SPI_BLACK_4
+};
+
+static inline void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
 {
-    // Each color of 1 bit is represented by 3 bits of SPI, low_level:100 ,high_level:110
-    // So a color byte occupies 3 bytes of SPI.
-    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
-    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
-    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
-    *(buf + 1) |= BIT(0);
-    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
-    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
-    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
-    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
-    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+    const uint8_t *code = spi_lut[data];
+    buf[0] = code[0];
+    buf[1] = code[1];
+    buf[2] = code[2];
 }
 
 static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
@@ -53,7 +69,6 @@ static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uin
     ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
     // LED_PIXEL_FORMAT_GRB takes 72bits(9bytes)
     uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
     __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
     __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
     __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
@@ -71,7 +86,6 @@ static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     // LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
     uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
     // SK6812 component order is GRBW
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
     __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
     __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
     __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
@@ -80,6 +94,25 @@ static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     return ESP_OK;
 }
 
+static esp_err_t led_strip_spi_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *buffer, led_buffer_format_t format)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= spi_strip->strip_len && count <= spi_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint32_t spi_bytes_per_pixel = spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint8_t *buf = spi_strip->pixel_buf + start * spi_bytes_per_pixel;
+    uint8_t in_stride = format == LED_BUFFER_FORMAT_RGBW ? 4 : 3;
+    for (uint32_t i = 0; i < count; i++, buf += spi_bytes_per_pixel, buffer += in_stride) {
+        // GRB(W) order on the wire
+        __led_strip_spi_bit(buffer[1], buf);
+        __led_strip_spi_bit(buffer[0], buf + SPI_BYTES_PER_COLOR_BYTE);
+        __led_strip_spi_bit(buffer[2], buf + SPI_BYTES_PER_COLOR_BYTE * 2);
+        if (spi_strip->bytes_per_pixel > 3) {
+            __led_strip_spi_bit(in_stride > 3 ? buffer[3] : 0, buf + SPI_BYTES_PER_COLOR_BYTE * 3);
+        }
+    }
+    return ESP_OK;
+}
+
 static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
@@ -94,15 +127,32 @@ static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
     return ESP_OK;
 }
 
+static esp_err_t led_strip_spi_refresh_from(led_strip_t *strip, const uint8_t *data, uint32_t count, const led_strip_transform_t *transform)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(count <= spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    // Transform a few pixels at a time and encode them right away
+    uint8_t pixels[SPI_TRANSFORM_CHUNK_PIXELS * 4];
+    uint8_t *buf = spi_strip->pixel_buf;
+    for (uint32_t done = 0; done < count;) {
+        uint32_t n = count - done < SPI_TRANSFORM_CHUNK_PIXELS ? count - done : SPI_TRANSFORM_CHUNK_PIXELS;
+        led_strip_transform_pixels(transform, data, done, n, pixels, spi_strip->bytes_per_pixel);
+        for (uint32_t i = 0; i < n * spi_strip->bytes_per_pixel; i++, buf += SPI_BYTES_PER_COLOR_BYTE) {
+            __led_strip_spi_bit(pixels[i], buf);
+        }
+        done += n;
+    }
+    return led_strip_spi_refresh(strip);
+}
+
 static esp_err_t led_strip_spi_clear(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
-    //Write zero to turn off all leds
-    memset(spi_strip->pixel_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
+    //Write zero to turn off all leds, the buffer is a multiple of the color byte size
+    size_t len = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
     uint8_t *buf = spi_strip->pixel_buf;
-    for (int index = 0; index < spi_strip->strip_len * spi_strip->bytes_per_pixel; index++) {
-        __led_strip_spi_bit(0, buf);
-        buf += SPI_BYTES_PER_COLOR_BYTE;
+    for (size_t done = 0; done < len; done += SPI_BLACK_BYTES) {
+        memcpy(buf + done, spi_black, len - done < SPI_BLACK_BYTES ? len - done : SPI_BLACK_BYTES);
     }
 
     return led_strip_spi_refresh(strip);
@@ -124,6 +174,8 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     led_strip_spi_obj *spi_strip = NULL;
     esp_err_t ret = ESP_OK;
     ESP_GOTO_ON_FALSE(led_config && spi_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->led_model == LED_MODEL_WS2812 || led_config->led_model == LED_MODEL_SK6812,
+                      ESP_ERR_INVALID_ARG, err, TAG, "clocked led models need led_strip_new_apa102_device");
     ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
     uint8_t bytes_per_pixel = 3;
     if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
@@ -189,7 +241,9 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     spi_strip->strip_len = led_config->max_leds;
     spi_strip->base.set_pixel = led_strip_spi_set_pixel;
     spi_strip->base.set_pixel_rgbw = led_strip_spi_set_pixel_rgbw;
+    spi_strip->base.set_pixels = led_strip_spi_set_pixels;
     spi_strip->base.refresh = led_strip_spi_refresh;
+    spi_strip->base.refresh_from = led_strip_spi_refresh_from;
     spi_strip->base.clear = led_strip_spi_clear;
     spi_strip->base.del = led_strip_spi_del;
 
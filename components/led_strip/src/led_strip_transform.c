@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2026 boomstick contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include "led_strip_transform.h"
+
+bool led_strip_transform_valid(const led_strip_transform_t *transform)
+{
+    return transform &&
+           transform->stride > 0 &&
+           transform->red < transform->stride &&
+           transform->green < transform->stride &&
+           transform->blue < transform->stride &&
+           transform->white < (int) transform->stride &&
+           transform->intensity < (int) transform->stride;
+}
+
+// Round a 16 bit level to 8 bits, carrying the remainder in *error when dithering
+static inline uint8_t led_strip_dither(uint32_t level, uint8_t *error)
+{
+    if (error) {
+        level += *error;
+        *error = level & 0xff;
+    } else {
+        level += 0x80;
+    }
+    level >>= 8;
+    return level > 0xff ? 0xff : level;
+}
+
+static void led_strip_transform_pixels16(const led_strip_transform_t *transform, const uint8_t *src, uint32_t first, uint32_t count,
+                                         uint8_t *dst, uint8_t bytes_per_pixel)
+{
+    const uint16_t *gamma16 = transform->gamma16;
+    uint8_t *error = transform->dither ? transform->dither + first * bytes_per_pixel : NULL;
+    uint32_t channels[4];
+    src += first * transform->stride;
+    for (uint32_t i = 0; i < count; i++, src += transform->stride, dst += bytes_per_pixel) {
+        // GRB(W) order on the wire
+        channels[0] = gamma16[src[transform->green]];
+        channels[1] = gamma16[src[transform->red]];
+        channels[2] = gamma16[src[transform->blue]];
+        channels[3] = transform->white >= 0 ? gamma16[src[transform->white]] : 0;
+        uint32_t intensity = transform->intensity >= 0 ? gamma16[src[transform->intensity]] : 0;
+        for (int c = 0; c < bytes_per_pixel; c++) {
+            uint32_t level = channels[c];
+            if (transform->intensity >= 0) {
+                level = (level * intensity) >> 16;
+            }
+            dst[c] = led_strip_dither(level, error);
+            if (error) {
+                error++;
+            }
+        }
+    }
+}
+
+void led_strip_transform_pixels(const led_strip_transform_t *transform, const uint8_t *src, uint32_t first, uint32_t count,
+                                uint8_t *dst, uint8_t bytes_per_pixel)
+{
+    if (transform->gamma16) {
+        led_strip_transform_pixels16(transform, src, first, count, dst, bytes_per_pixel);
+        return;
+    }
+    const uint8_t *gamma = transform->gamma;
+    src += first * transform->stride;
+    for (uint32_t i = 0; i < count; i++, src += transform->stride, dst += bytes_per_pixel) {
+        uint32_t red = src[transform->red];
+        uint32_t green = src[transform->green];
+        uint32_t blue = src[transform->blue];
+        uint32_t white = transform->white >= 0 ? src[transform->white] : 0;
+        if (transform->intensity >= 0) {
+            uint32_t intensity = src[transform->intensity];
+            red = (red * intensity) >> 8;
+            green = (green * intensity) >> 8;
+            blue = (blue * intensity) >> 8;
+            white = (white * intensity) >> 8;
+        }
+        if (gamma) {
+            red = gamma[red];
+            green = gamma[green];
+            blue = gamma[blue];
+            white = gamma[white];
+        }
+        // GRB(W) order on the wire
+        dst[0] = green;
+        dst[1] = red;
+        dst[2] = blue;
+        if (bytes_per_pixel > 3) {
+            dst[3] = white;
+        }
+    }
+}
+
+void led_strip_transform_levels(const led_strip_transform_t *transform, const uint8_t *src, uint32_t first, uint32_t count,
+                                uint16_t *dst, uint8_t channels)
+{
+    if (!transform->gamma16) {
+        uint8_t pixel[4];
+        for (uint32_t i = 0; i < count; i++, dst += channels) {
+            led_strip_transform_pixels(transform, src, first + i, 1, pixel, channels);
+            for (int c = 0; c < channels; c++) {
+                dst[c] = pixel[c] * 257;
+            }
+        }
+        return;
+    }
+    const uint16_t *gamma16 = transform->gamma16;
+    src += first * transform->stride;
+    for (uint32_t i = 0; i < count; i++, src += transform->stride, dst += channels) {
+        // GRB(W) order on the wire
+        dst[0] = gamma16[src[transform->green]];
+        dst[1] = gamma16[src[transform->red]];
+        dst[2] = gamma16[src[transform->blue]];
+        if (channels > 3) {
+            dst[3] = transform->white >= 0 ? gamma16[src[transform->white]] : 0;
+        }
+        if (transform->intensity >= 0) {
+            uint32_t intensity = gamma16[src[transform->intensity]];
+            for (int c = 0; c < channels; c++) {
+                dst[c] = (dst[c] * intensity) >> 16;
+            }
+        }
+    }
+}
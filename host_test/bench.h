@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_PIXELS 1000
+#define BENCH_ROUNDS 2000
+
+static inline int64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void bench_print(const char *name, int64_t ns, uint32_t items)
+{
+    printf("%-12s %.2f ns/pixel\n", name, (double) ns / items);
+}
@@ -0,0 +1,87 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "led_strip.h"
+
+static uint16_t gamma16[256];
+
+/*
+ * Over 256 refreshes the dithered output of every level has to add up to
+ * its 16 bit level, give or take the error still carried at the end.
+ * Only levels the 8 bit output can reach on average are checked.
+ */
+static int check_dither(led_strip_transform_t transform)
+{
+    static uint8_t rgbi[256 * 4];
+    static uint8_t dither[256 * 3];
+    static uint16_t levels[256 * 3];
+    static uint32_t sums[256 * 3];
+    uint8_t out[256 * 3];
+    for (int i = 0; i < 256; i++) {
+        rgbi[4*i] = rgbi[4*i+1] = rgbi[4*i+2] = i;
+        rgbi[4*i+3] = 255;
+    }
+    transform.dither = dither;
+    led_strip_transform_levels(&transform, rgbi, 0, 256, levels, 3);
+    for (int frame = 0; frame < 256; frame++) {
+        led_strip_transform_pixels(&transform, rgbi, 0, 256, out, 3);
+        for (int i = 0; i < 256 * 3; i++) {
+            sums[i] += out[i];
+        }
+    }
+    for (int i = 0; i < 256 * 3; i++) {
+        if (levels[i] <= 0xff00 && (sums[i] > levels[i] || sums[i] + 1 < levels[i])) {
+            printf("Dithered level %u averages to %u / 256\n", levels[i], sums[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Cost of the output processing stages per pixel, to check they fit the frame budget
+int main(void)
+{
+    static uint8_t rgbi[BENCH_PIXELS * 4];
+    static uint8_t out[BENCH_PIXELS * 3];
+    static uint8_t dither[BENCH_PIXELS * 3];
+    srand(1);
+    for (uint32_t i = 0; i < sizeof(rgbi); i++) {
+        rgbi[i] = rand();
+    }
+    for (int i = 0; i < 256; i++) {
+        gamma16[i] = lroundf(powf(i / 255.0f, 2.2f) * 65535.0f);
+    }
+    led_strip_transform_t transform = {
+        .stride = 4,
+        .red = 0,
+        .green = 1,
+        .blue = 2,
+        .white = -1,
+        .intensity = 3,
+    };
+    const struct {
+        const char *name;
+        const uint16_t *gamma16;
+        uint8_t *dither;
+    } stages[] = {
+        { "8 bit", NULL, NULL },
+        { "gamma", gamma16, NULL },
+        { "dithered", gamma16, dither },
+    };
+
+    for (size_t s = 0; s < sizeof(stages) / sizeof(stages[0]); s++) {
+        transform.gamma16 = stages[s].gamma16;
+        transform.dither = stages[s].dither;
+        int64_t start = bench_now_ns();
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            led_strip_transform_pixels(&transform, rgbi, 0, BENCH_PIXELS, out, 3);
+        }
+        bench_print(stages[s].name, bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+    }
+
+    transform.gamma16 = gamma16;
+    return check_dither(transform);
+}
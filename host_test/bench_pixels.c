@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "led_strip.h"
+#include "stub_strip.h"
+
+// led_strip_set_pixel per pixel against one led_strip_set_pixels call over a strip of BENCH_PIXELS
+int main(void)
+{
+    led_strip_handle_t strip;
+    if (stub_strip_new(BENCH_PIXELS, 3, &strip) != ESP_OK) {
+        return 1;
+    }
+    uint8_t rgb[BENCH_PIXELS * 3];
+    for (uint32_t i = 0; i < sizeof(rgb); i++) {
+        rgb[i] = i * 7;
+    }
+
+    int64_t start = bench_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (uint32_t i = 0; i < BENCH_PIXELS; i++) {
+            led_strip_set_pixel(strip, i, rgb[3*i], rgb[3*i+1], rgb[3*i+2]);
+        }
+    }
+    bench_print("set_pixel", bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+    uint8_t per_pixel[BENCH_PIXELS * 3];
+    memcpy(per_pixel, stub_strip_pixels(strip), sizeof(per_pixel));
+
+    led_strip_clear(strip);
+    start = bench_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        led_strip_set_pixels(strip, 0, BENCH_PIXELS, rgb, LED_BUFFER_FORMAT_RGB);
+    }
+    bench_print("set_pixels", bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+
+    // Both ways have to leave the same pixels behind
+    int ret = 0;
+    if (memcmp(per_pixel, stub_strip_pixels(strip), sizeof(per_pixel)) != 0) {
+        printf("set_pixels output differs from set_pixel\n");
+        ret = 1;
+    }
+    led_strip_del(strip);
+    return ret;
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "led_strip.h"
+#include "stub_spi.h"
+
+#define BIT(n) (1u << (n))
+
+/*
+ * The SPI backend encoder as it was before the lookup table, kept
+ * here as the reference the table driven one is measured against.
+ */
+static void spi_bit_reference(uint8_t data, uint8_t *buf)
+{
+    buf[2] |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
+    buf[2] |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
+    buf[2] |= data & BIT(2) ? BIT(7) : 0x00;
+    buf[1] |= BIT(0);
+    buf[1] |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
+    buf[1] |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
+    buf[0] |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
+    buf[0] |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
+    buf[0] |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+}
+
+// Compare the strip's SPI data as sent with the reference encoding
+static int check_sent(led_strip_handle_t strip, const uint8_t *reference, const char *name)
+{
+    size_t len;
+    led_strip_refresh(strip);
+    const uint8_t *sent = stub_spi_last_tx(&len);
+    if (!sent || len != BENCH_PIXELS * 9 || memcmp(sent, reference, len) != 0) {
+        printf("%s output differs from the reference encoder\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+// SPI strip encoding, old bit by bit encoder against the lookup table
+int main(void)
+{
+    static uint8_t rgb[BENCH_PIXELS * 3];
+    static uint8_t reference[BENCH_PIXELS * 9];
+    for (uint32_t i = 0; i < sizeof(rgb); i++) {
+        rgb[i] = i * 7;
+    }
+
+    led_strip_config_t strip_config = {
+        .strip_gpio_num = -1,
+        .max_leds = BENCH_PIXELS,
+        .led_pixel_format = LED_PIXEL_FORMAT_GRB,
+        .led_model = LED_MODEL_WS2812,
+    };
+    led_strip_spi_config_t spi_config = {
+        .spi_bus = SPI2_HOST,
+    };
+    led_strip_handle_t strip;
+    if (led_strip_new_spi_device(&strip_config, &spi_config, &strip) != ESP_OK) {
+        printf("Failed to create a SPI strip\n");
+        return 1;
+    }
+
+    int64_t start = bench_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        memset(reference, 0, sizeof(reference));
+        for (uint32_t i = 0; i < BENCH_PIXELS; i++) {
+            spi_bit_reference(rgb[3*i+1], &reference[9*i]);
+            spi_bit_reference(rgb[3*i], &reference[9*i+3]);
+            spi_bit_reference(rgb[3*i+2], &reference[9*i+6]);
+        }
+    }
+    bench_print("reference", bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+
+    int ret = 0;
+    start = bench_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (uint32_t i = 0; i < BENCH_PIXELS; i++) {
+            led_strip_set_pixel(strip, i, rgb[3*i], rgb[3*i+1], rgb[3*i+2]);
+        }
+    }
+    bench_print("set_pixel", bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+    ret |= check_sent(strip, reference, "set_pixel");
+
+    led_strip_clear(strip);
+    start = bench_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        led_strip_set_pixels(strip, 0, BENCH_PIXELS, rgb, LED_BUFFER_FORMAT_RGB);
+    }
+    bench_print("set_pixels", bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+    ret |= check_sent(strip, reference, "set_pixels");
+
+    led_strip_del(strip);
+    return ret;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "led_strip.h"
+#include "stub_strip.h"
+
+static const led_strip_transform_t rgbi_transform = {
+    .stride = 4,
+    .red = 0,
+    .green = 1,
+    .blue = 2,
+    .white = -1,
+    .intensity = 3,
+};
+
+/*
+ * RGBI slots to strip pixels the way render did before the transform,
+ * scaled by the intensity and set one pixel at a time.
+ */
+static void reference_set(led_strip_handle_t strip, const uint8_t *rgbi, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++, rgbi += 4) {
+        uint8_t r = (rgbi[0] * rgbi[3]) >> 8;
+        uint8_t g = (rgbi[1] * rgbi[3]) >> 8;
+        uint8_t b = (rgbi[2] * rgbi[3]) >> 8;
+        led_strip_set_pixel(strip, i, r, g, b);
+    }
+}
+
+// Every color and intensity pair through both, the strip bytes must match
+static int check_all_levels(led_strip_handle_t reference, led_strip_handle_t transformed)
+{
+    // One pixel per intensity, the color channels differ so a swap shows up
+    static uint8_t rgbi[256 * 4];
+    for (int c = 0; c < 256; c++) {
+        for (int i = 0; i < 256; i++) {
+            rgbi[4*i] = c;
+            rgbi[4*i+1] = c ^ 0x55;
+            rgbi[4*i+2] = c ^ 0xaa;
+            rgbi[4*i+3] = i;
+        }
+        reference_set(reference, rgbi, 256);
+        led_strip_refresh_from(transformed, rgbi, 256, &rgbi_transform);
+        if (memcmp(stub_strip_pixels(reference), stub_strip_pixels(transformed), 256 * 3) != 0) {
+            printf("Transformed pixels differ from the reference for color %d\n", c);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The old scale and reorder against led_strip_transform_pixels, byte for byte
+int main(void)
+{
+    led_strip_handle_t reference, transformed;
+    if (stub_strip_new(BENCH_PIXELS, 3, &reference) != ESP_OK || stub_strip_new(BENCH_PIXELS, 3, &transformed) != ESP_OK) {
+        return 1;
+    }
+    int ret = check_all_levels(reference, transformed);
+
+    static uint8_t rgbi[BENCH_PIXELS * 4];
+    static uint8_t out[BENCH_PIXELS * 3];
+    srand(1);
+    for (uint32_t i = 0; i < sizeof(rgbi); i++) {
+        rgbi[i] = rand();
+    }
+
+    int64_t start = bench_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        reference_set(reference, rgbi, BENCH_PIXELS);
+    }
+    bench_print("reference", bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+
+    start = bench_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        led_strip_transform_pixels(&rgbi_transform, rgbi, 0, BENCH_PIXELS, out, 3);
+    }
+    bench_print("transform", bench_now_ns() - start, BENCH_ROUNDS * BENCH_PIXELS);
+
+    if (memcmp(stub_strip_pixels(reference), out, sizeof(out)) != 0) {
+        printf("Transformed pixels differ from the reference\n");
+        ret = 1;
+    }
+    led_strip_del(reference);
+    led_strip_del(transformed);
+    return ret;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Data of the last transaction handed to the stub SPI driver
+ *
+ * @param bytes Returned length of the transaction
+ * @return The transmit buffer, NULL if nothing was sent yet
+ */
+const uint8_t *stub_spi_last_tx(size_t *bytes);
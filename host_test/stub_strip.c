@@ -0,0 +1,111 @@
+#include "stub_strip.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "led_strip_interface.h"
+
+static const char *TAG = "stub_strip";
+
+typedef struct {
+    led_strip_t base;
+    uint32_t strip_len;
+    uint8_t bytes_per_pixel;
+    uint8_t pixel_buf[];
+} stub_strip_obj;
+
+static esp_err_t stub_strip_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    stub_strip_obj *stub = __containerof(strip, stub_strip_obj, base);
+    ESP_RETURN_ON_FALSE(index < stub->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint32_t start = index * stub->bytes_per_pixel;
+    stub->pixel_buf[start + 0] = green & 0xFF;
+    stub->pixel_buf[start + 1] = red & 0xFF;
+    stub->pixel_buf[start + 2] = blue & 0xFF;
+    if (stub->bytes_per_pixel > 3) {
+        stub->pixel_buf[start + 3] = 0;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t stub_strip_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    stub_strip_obj *stub = __containerof(strip, stub_strip_obj, base);
+    ESP_RETURN_ON_FALSE(index < stub->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(stub->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
+    uint8_t *buf = stub->pixel_buf + index * 4;
+    buf[0] = green & 0xFF;
+    buf[1] = red & 0xFF;
+    buf[2] = blue & 0xFF;
+    buf[3] = white & 0xFF;
+    return ESP_OK;
+}
+
+// Same reordering loops as the RMT backend
+static esp_err_t stub_strip_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *buffer, led_buffer_format_t format)
+{
+    stub_strip_obj *stub = __containerof(strip, stub_strip_obj, base);
+    ESP_RETURN_ON_FALSE(start <= stub->strip_len && count <= stub->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint8_t *buf = stub->pixel_buf + start * stub->bytes_per_pixel;
+    const uint8_t *end = buf + count * stub->bytes_per_pixel;
+    uint8_t in_stride = format == LED_BUFFER_FORMAT_RGBW ? 4 : 3;
+    for (; buf < end; buf += stub->bytes_per_pixel, buffer += in_stride) {
+        buf[0] = buffer[1];
+        buf[1] = buffer[0];
+        buf[2] = buffer[2];
+        if (stub->bytes_per_pixel > 3) {
+            buf[3] = in_stride > 3 ? buffer[3] : 0;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t stub_strip_refresh(led_strip_t *strip)
+{
+    return ESP_OK;
+}
+
+static esp_err_t stub_strip_refresh_from(led_strip_t *strip, const uint8_t *data, uint32_t count, const led_strip_transform_t *transform)
+{
+    stub_strip_obj *stub = __containerof(strip, stub_strip_obj, base);
+    ESP_RETURN_ON_FALSE(count <= stub->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    led_strip_transform_pixels(transform, data, 0, count, stub->pixel_buf, stub->bytes_per_pixel);
+    return ESP_OK;
+}
+
+static esp_err_t stub_strip_clear(led_strip_t *strip)
+{
+    stub_strip_obj *stub = __containerof(strip, stub_strip_obj, base);
+    memset(stub->pixel_buf, 0, stub->strip_len * stub->bytes_per_pixel);
+    return ESP_OK;
+}
+
+static esp_err_t stub_strip_del(led_strip_t *strip)
+{
+    free(__containerof(strip, stub_strip_obj, base));
+    return ESP_OK;
+}
+
+esp_err_t stub_strip_new(uint32_t max_leds, uint8_t bytes_per_pixel, led_strip_handle_t *ret_strip)
+{
+    ESP_RETURN_ON_FALSE(ret_strip && (bytes_per_pixel == 3 || bytes_per_pixel == 4), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    stub_strip_obj *stub = calloc(1, sizeof(stub_strip_obj) + max_leds * bytes_per_pixel);
+    ESP_RETURN_ON_FALSE(stub, ESP_ERR_NO_MEM, TAG, "no mem for stub strip");
+    stub->strip_len = max_leds;
+    stub->bytes_per_pixel = bytes_per_pixel;
+    stub->base.set_pixel = stub_strip_set_pixel;
+    stub->base.set_pixel_rgbw = stub_strip_set_pixel_rgbw;
+    stub->base.set_pixels = stub_strip_set_pixels;
+    stub->base.refresh = stub_strip_refresh;
+    stub->base.refresh_from = stub_strip_refresh_from;
+    stub->base.clear = stub_strip_clear;
+    stub->base.del = stub_strip_del;
+    *ret_strip = &stub->base;
+    return ESP_OK;
+}
+
+const uint8_t *stub_strip_pixels(led_strip_handle_t strip)
+{
+    return __containerof(strip, stub_strip_obj, base)->pixel_buf;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include "led_strip.h"
+
+/**
+ * @brief Create an LED strip that only keeps its pixels in memory
+ *
+ * The pixel buffer is GRB(W) like the one of the RMT backend, refreshes
+ * don't send anything.
+ *
+ * @param max_leds Number of LEDs
+ * @param bytes_per_pixel 3 for GRB, 4 for GRBW
+ * @param ret_strip Returned LED strip handle
+ */
+esp_err_t stub_strip_new(uint32_t max_leds, uint8_t bytes_per_pixel, led_strip_handle_t *ret_strip);
+
+/**
+ * @brief Pixel buffer of a strip made by `stub_strip_new`, in the byte order sent to the LEDs
+ */
+const uint8_t *stub_strip_pixels(led_strip_handle_t strip);
@@ -0,0 +1,7 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int rmt_clock_source_t;
+
+#define RMT_CLK_SRC_DEFAULT 0
@@ -0,0 +1,8 @@
+#pragma once
+#include <stdlib.h>
+
+#define MALLOC_CAP_DEFAULT (1 << 12)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DMA (1 << 3)
+
+#define heap_caps_calloc(n, size, caps) calloc(n, size)
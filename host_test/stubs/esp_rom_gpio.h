@@ -0,0 +1,7 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+static inline void esp_rom_gpio_connect_out_signal(uint32_t gpio_num, uint32_t signal_idx, bool out_inv, bool oen_inv)
+{
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+
+typedef struct {
+    uint8_t spid_out;
+} spi_signal_conn_t;
+
+static const spi_signal_conn_t spi_periph_signal[] = { { 0 }, { 0 }, { 0 } };
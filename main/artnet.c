@@ -1,298 +1,595 @@
 // Assumes a full UDP message is passed as one
 #include "artnet.h"
 
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <arpa/inet.h>
 #include <sys/socket.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 #include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
 
-#include "common.h"
 #include "config.h"
-#include "driver/ledc.h"
-#include "led_strip.h"
+#include "render.h"
+#include "util.h"
 
 #define ARTNET_MAGIC_HEADER "Art-Net\0"
 #define ARTNET_MAGIC_HEADER_LEN 8
 
 #define PORT 6454
 
-// Nice to have, sync packet latches new data
-//static boolean synchronous = false;
+// Upper bound of packets handled before the pending frame is committed,
+// so a flood of packets can not starve the render task forever
+#define MAX_DRAIN_PACKETS 32
+
+#define OPCODE_POLL 0x2000
+#define OPCODE_POLL_REPLY 0x2100
+#define OPCODE_DIAG_DATA 0x2300
+#define OPCODE_DMX 0x5000
+#define OPCODE_SYNC 0x5200
+
+#define PROTOCOL_VERSION 14
+
+// ArtPoll flags
+#define POLL_FLAG_REPLY_ON_CHANGE 0x02
+#define POLL_FLAG_DIAGNOSTICS 0x04
+#define POLL_FLAG_DIAG_UNICAST 0x08
+#define POLL_FLAG_TARGETED 0x20
+
+// Diagnostics priorities
+#define DIAG_LOW 0x10
+#define DIAG_MEDIUM 0x40
+
+#define POLL_REPLY_LEN 239
+// An ArtPollReply describes up to four ports sharing the upper bits of
+// their port address, more universes take several replies
+#define POLL_REPLY_PORTS 4
+#define DIAG_HEADER_LEN 18
+#define DIAG_MAX_LEN 128
+
+#define FIRMWARE_VERSION 0x0001
+// OemUnknown and the ESTA prototyping id, no codes have been registered
+#define OEM_CODE 0x00ff
+#define ESTA_MANUFACTURER 0x7ff0
+// Indicators normal, port addresses set locally (console)
+#define STATUS1 0xd0
+// DHCP configured and capable, 15 bit port addresses
+#define STATUS2 0x0e
+// Output of DMX512 from Art-Net
+#define PORT_TYPE_DMX_OUTPUT 0x80
+#define GOOD_OUTPUT_A_DATA 0x80
+// RDM disabled, continuous output
+#define GOOD_OUTPUT_B 0xc0
+#define REPORT_POWER_OK 0x0001
+
+// A port is reported as outputting while it has had ArtDmx this recently.
+// Controllers poll every few seconds.
+#define PORT_ACTIVE_MS 4000
+
+/*
+ * A frame older than the last one accepted is dropped, unless this many
+ * in a row were, or nothing was accepted for SEQUENCE_RESYNC_MS. Then
+ * the controller has most likely restarted its sequence.
+ */
+#define SEQUENCE_RESYNC_FRAMES 4
+#define SEQUENCE_RESYNC_MS 1000
+
+// Lost universes of incomplete frames are reported at most this often
+#define INCOMPLETE_DIAG_INTERVAL_MS 1000
+
+// Art-Net 4 reverts to immediate output 4 s after the last ArtSync
+#define DEFAULT_SYNC_TIMEOUT_MS 4000
+
+// A frame spanning several universes is output at the latest this
+// long after its first universe arrived, even if some are missing
+#define FRAME_DEADLINE_MS 10
 
 static const char *TAG = "ART-NET";
 
-led_strip_handle_t led_strip;
+static int sock = -1;
+
+static int32_t artnet_universe;
+static unsigned int universe_count = 1;
+// Bit n is set when universe artnet_universe + n is part of the frame
+static uint32_t all_universes = 1;
+// 0 disables synchronous output, ArtSync is then ignored
+static int32_t sync_timeout_ms;
+
+static struct timing parse_timing;
+
+static struct {
+    uint32_t received;  // ArtDmx frames for our universe
+    uint32_t coalesced; // frames replaced by a newer one before rendering
+    uint32_t syncs;     // ArtSync packets that latched a frame
+    uint32_t incomplete; // frames output at the deadline with universes missing
+    uint32_t polls;     // ArtPoll packets received
+    uint32_t replies;   // ArtPollReply packets sent
+    uint32_t diags;     // ArtDiagData packets sent
+} counters;
+
+static char node_name[MAX_NODE_NAME_LEN + 1];
+static uint8_t mac[6];
+// Last ArtDmx of each universe of the frame, reported in ArtPollReply
+static int64_t universe_rx_time[RENDER_MAX_UNIVERSES];
+
+/*
+ * ArtDmx sequence numbers run from 1 to 255 and wrap back to 1,
+ * 0 means the sender does not number its frames.
+ */
+static struct {
+    uint8_t last;           // last accepted sequence, 0 when not tracking
+    uint8_t late_streak;    // frames dropped as late since the last accepted
+    uint32_t reordered;     // frames dropped for arriving after a newer one
+    uint32_t duplicates;
+    uint32_t missing;       // sequence numbers skipped, late ones included
+} sequence[RENDER_MAX_UNIVERSES];
+
+// What the controller that polled last asked for
+static struct {
+    uint32_t ip;
+    bool reply_on_change;
+    bool diagnostics;
+    bool diag_unicast;
+    uint8_t diag_priority;
+} poller;
+// Set when the state in ArtPollReply changed and the poller wants to know
+static bool reply_pending = false;
+static int64_t last_incomplete_diag;
+
+// Packets dropped by artnet_classify(), counted instead of logged
+static struct {
+    uint32_t foreign;   // ArtDmx of universes we do not output
+    uint32_t other;     // Art-Net packets we have no use for
+    uint32_t invalid;   // not Art-Net, malformed or of an old protocol version
+} drops;
+
+// Time from the first buffered ArtDmx frame to the ArtSync latching it
+static struct timing sync_wait_timing;
+
+// An ArtDmx frame has been written to the render back buffer but not committed
+static bool frame_pending = false;
+static int64_t frame_pending_since;
+// Universes of the pending frame received so far
+static uint32_t frame_universes;
+
+/*
+ * Synchronous mode is entered when an ArtSync arrives. ArtDmx frames
+ * are then only output on the next ArtSync, until no ArtSync has been
+ * seen for sync_timeout_ms.
+ */
+static bool synchronous = false;
+static int64_t last_sync_time;
+// ArtSync is only valid from the controller sending us ArtDmx
+static uint32_t dmx_source_ip;
+
+static void init(void)
+{
+    get_mac_bytes(mac);
+    if (load_node_name(node_name)) {
+        snprintf(node_name, sizeof(node_name), "boomstick-%02X%02X%02X", mac[3], mac[4], mac[5]);
+    }
 
-//#define LED_STRIP_GPIO 10
-enum led_type led_type;
+    artnet_universe = render_first_universe();
+    int err = load_artnet_sync_timeout(&sync_timeout_ms);
+    if (err) {
+        sync_timeout_ms = DEFAULT_SYNC_TIMEOUT_MS;
+    }
 
-int32_t artnet_universe;
-int32_t artnet_first_channel;
+    universe_count = render_universe_count();
+    all_universes = render_universe_mask();
+    if (universe_count > 1) {
+        ESP_LOGI(TAG, "Listening to universes %"PRId32"-%"PRId32,
+                artnet_universe, artnet_universe + universe_count - 1);
+    }
+}
 
-led_strip_handle_t led_strip;
-static bool leds_initialized = false;
+static bool get_ip_info(esp_netif_ip_info_t *info)
+{
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    return netif != NULL && esp_netif_get_ip_info(netif, info) == ESP_OK;
+}
 
-/* LED strip initialization with the GPIO and pixels number*/
-led_strip_config_t strip_config = {
-    .strip_gpio_num = -1, // The GPIO that connected to the LED strip's data line
-    .max_leds = -1, // The number of LEDs in the strip,
-    .led_pixel_format = LED_PIXEL_FORMAT_GRB, // Pixel format of your LED strip
-    .led_model = LED_MODEL_WS2812, // LED strip model
-    .flags.invert_out = false, // whether to invert the output signal (useful when your hardware has a level inverter)
-};
+static void send_packet(uint32_t ip, const uint8_t *buf, size_t len)
+{
+    if (sock < 0) {
+        return;
+    }
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = ip,
+    };
+    if (sendto(sock, buf, len, 0, (struct sockaddr *)&dest, sizeof(dest)) < 0) {
+        ESP_LOGW(TAG, "sendto failed: errno %d", errno);
+    }
+}
 
-led_strip_rmt_config_t rmt_config = {
-    .clk_src = RMT_CLK_SRC_DEFAULT, // different clock source can lead to different power consumption
-    .resolution_hz = 10 * 1000 * 1000, // 10MHz
-    .flags.with_dma = false, // whether to enable the DMA feature
-};
+static void write_header(uint8_t *buf, uint16_t opcode)
+{
+    memcpy(buf, ARTNET_MAGIC_HEADER, ARTNET_MAGIC_HEADER_LEN);
+    buf[8] = opcode & 0xff;
+    buf[9] = opcode >> 8;
+}
 
+/*
+ * Send an ArtDiagData, if the last poller asked for diagnostics
+ * of at least this priority.
+ */
+static void send_diag(uint8_t priority, const char *fmt, ...)
+{
+    if (!poller.diagnostics || priority < poller.diag_priority) {
+        return;
+    }
 
+    uint8_t buf[DIAG_HEADER_LEN + DIAG_MAX_LEN] = {0};
+    write_header(buf, OPCODE_DIAG_DATA);
+    buf[11] = PROTOCOL_VERSION;
+    buf[13] = priority;
 
-static int init_led_strip()
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf((char *)&buf[DIAG_HEADER_LEN], DIAG_MAX_LEN, fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    // The length includes the terminating zero
+    len = len < DIAG_MAX_LEN ? len + 1 : DIAG_MAX_LEN;
+    buf[16] = len >> 8;
+    buf[17] = len & 0xff;
+
+    uint32_t dest_ip = poller.ip;
+    if (!poller.diag_unicast) {
+        esp_netif_ip_info_t info;
+        if (!get_ip_info(&info)) {
+            return;
+        }
+        dest_ip = info.ip.addr | ~info.netmask.addr;
+    }
+    send_packet(dest_ip, buf, DIAG_HEADER_LEN + len);
+    counters.diags++;
+}
+
+// ports are universe indexes of the frame, n at most POLL_REPLY_PORTS
+static void send_poll_reply(uint32_t dest_ip, const unsigned int *ports, unsigned int n,
+        unsigned int bind_index, int64_t now)
 {
-    int32_t val;
-    RETURN_ON_ERR(load_strip_led_count(&val));
-    strip_config.max_leds = val;
-    RETURN_ON_ERR(load_strip_pin(&val));
-    strip_config.strip_gpio_num = val;
-    if (strip_config.max_leds >= 1 &&
-            strip_config.strip_gpio_num >= 0) {
-        ESP_LOGI(TAG, "loading led strip");
-        RETURN_ON_ERR(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip));
-    }
-    return 0;
+    uint8_t buf[POLL_REPLY_LEN] = {0};
+    esp_netif_ip_info_t info = {0};
+    get_ip_info(&info);
+
+    write_header(buf, OPCODE_POLL_REPLY);
+    memcpy(&buf[10], &info.ip.addr, 4);
+    buf[14] = PORT & 0xff;
+    buf[15] = PORT >> 8;
+    buf[16] = FIRMWARE_VERSION >> 8;
+    buf[17] = FIRMWARE_VERSION & 0xff;
+    if (n > 0) {
+        uint16_t address = artnet_universe + ports[0];
+        buf[18] = (address >> 8) & 0x7f; // NetSwitch
+        buf[19] = (address >> 4) & 0x0f; // SubSwitch
+    }
+    buf[20] = OEM_CODE >> 8;
+    buf[21] = OEM_CODE & 0xff;
+    buf[23] = STATUS1;
+    buf[24] = ESTA_MANUFACTURER & 0xff;
+    buf[25] = ESTA_MANUFACTURER >> 8;
+    // Short name is 18 and long name 64 bytes, both zero terminated
+    snprintf((char *)&buf[26], 18, "%s", node_name);
+    snprintf((char *)&buf[44], 64, "%s", node_name);
+    snprintf((char *)&buf[108], 64, "#%04x [%04"PRIu32"] %"PRIu32" frames, %s output",
+            REPORT_POWER_OK, counters.replies % 10000, counters.received,
+            synchronous ? "synchronous" : "immediate");
+    buf[173] = n;
+    for (unsigned int i = 0; i < n; i++) {
+        buf[174 + i] = PORT_TYPE_DMX_OUTPUT;
+        if (universe_rx_time[ports[i]] != 0
+                && now - universe_rx_time[ports[i]] < PORT_ACTIVE_MS * 1000LL) {
+            buf[182 + i] = GOOD_OUTPUT_A_DATA;
+        }
+        buf[190 + i] = (artnet_universe + ports[i]) & 0x0f; // SwOut
+        buf[213 + i] = GOOD_OUTPUT_B;
+    }
+    // Style 0 is StNode
+    memcpy(&buf[201], mac, sizeof(mac));
+    memcpy(&buf[207], &info.ip.addr, 4);
+    buf[211] = bind_index;
+    buf[212] = STATUS2;
+
+    send_packet(dest_ip, buf, sizeof(buf));
+    counters.replies++;
 }
 
-#define LEDC_TIMER LEDC_TIMER_2
-#define LEDC_FREQ (3000)
-#define LEDC_CHANNEL_R LEDC_CHANNEL_1
-#define LEDC_CHANNEL_G LEDC_CHANNEL_3
-#define LEDC_CHANNEL_B LEDC_CHANNEL_5
+/*
+ * Describe every universe of the frame, a page of up to four of them
+ * per reply. A targeted poll is only answered with the pages having
+ * a universe between bottom and top.
+ */
+static void send_poll_replies(uint32_t dest_ip, bool targeted, uint16_t bottom, uint16_t top)
+{
+    int64_t now = esp_timer_get_time();
+    unsigned int bind_index = 1;
+    unsigned int i = 0;
+
+    while (i < universe_count) {
+        unsigned int ports[POLL_REPLY_PORTS];
+        unsigned int n = 0;
+        bool wanted = !targeted;
+        for (; i < universe_count && n < POLL_REPLY_PORTS; i++) {
+            if (!(all_universes & 1u << i)) {
+                continue;
+            }
+            uint16_t address = artnet_universe + i;
+            if (n > 0 && address >> 4 != (artnet_universe + ports[0]) >> 4) {
+                break;
+            }
+            ports[n++] = i;
+            if (address >= bottom && address <= top) {
+                wanted = true;
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+        if (wanted) {
+            send_poll_reply(dest_ip, ports, n, bind_index, now);
+        }
+        bind_index++;
+    }
 
-static int init_led_rgb()
+    if (bind_index == 1 && !targeted) {
+        // No universes, still let the controller discover us
+        send_poll_reply(dest_ip, NULL, 0, bind_index, now);
+    }
+}
+
+static void handle_poll(const uint8_t *buf, size_t len, uint32_t source_ip)
 {
-    ledc_timer_config_t ledc_timer = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .timer_num  = LEDC_TIMER,
-        .duty_resolution = LEDC_TIMER_8_BIT,
-        .freq_hz         = LEDC_FREQ,
-        .clk_cfg         = LEDC_AUTO_CLK,
-    };
-    ledc_timer_config(&ledc_timer);
-
-    ledc_channel_config_t ledc_r_channel = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .channel    = LEDC_CHANNEL_R,
-        .timer_sel  = LEDC_TIMER,
-        .intr_type  = LEDC_INTR_DISABLE,
-        .gpio_num   = -1,
-        .duty       = 0,
-        .hpoint     = 50
-    };
+    uint8_t flags = buf[12];
+
+    counters.polls++;
+    poller.ip = source_ip;
+    poller.reply_on_change = flags & POLL_FLAG_REPLY_ON_CHANGE;
+    poller.diagnostics = flags & POLL_FLAG_DIAGNOSTICS;
+    poller.diag_unicast = flags & POLL_FLAG_DIAG_UNICAST;
+    // Art-Net 3 and older polls may end before the priority
+    poller.diag_priority = len > 13 ? buf[13] : DIAG_LOW;
+
+    bool targeted = (flags & POLL_FLAG_TARGETED) && len >= 18;
+    uint16_t top = targeted ? buf[14] << 8 | buf[15] : 0;
+    uint16_t bottom = targeted ? buf[16] << 8 | buf[17] : 0;
+
+    // Unicast back, so the reply does not wake up every node on the network
+    send_poll_replies(source_ip, targeted, bottom, top);
+}
 
-    ledc_channel_config_t ledc_g_channel = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .channel    = LEDC_CHANNEL_G,
-        .timer_sel  = LEDC_TIMER,
-        .intr_type  = LEDC_INTR_DISABLE,
-        .gpio_num   = -1,
-        .duty       = 0,
-        .hpoint     = 0
-    };
+// Something shown in ArtPollReply changed
+static void node_changed(void)
+{
+    if (poller.reply_on_change) {
+        reply_pending = true;
+    }
+}
 
-    ledc_channel_config_t ledc_b_channel = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .channel    = LEDC_CHANNEL_B,
-        .timer_sel  = LEDC_TIMER,
-        .intr_type  = LEDC_INTR_DISABLE,
-        .gpio_num   = -1,
-        .duty       = 0,
-        .hpoint     = 0
-    };
+static void commit_frame(void)
+{
+    frame_pending = false;
+    frame_universes = 0;
+    render_commit();
+}
 
-    int32_t rpin, gpin, bpin;
-    if (load_ledc_pins(&rpin, &gpin, &bpin) == ESP_OK)
-    {
-        ESP_LOGI(TAG, "loading ledc");
-        if (rpin >= 0) {
-            ledc_r_channel.gpio_num = rpin;
-            ESP_LOGI(TAG, "r pin: %d", ledc_r_channel.gpio_num);
-            ledc_channel_config(&ledc_r_channel);
-        }
-        if (gpin >= 0) {
-            ledc_g_channel.gpio_num = gpin;
-            ESP_LOGI(TAG, "g pin: %d", ledc_g_channel.gpio_num);
-            ledc_channel_config(&ledc_g_channel);
-        }
-        if (bpin >= 0) {
-            ledc_b_channel.gpio_num = bpin;
-            ESP_LOGI(TAG, "b pin: %d", ledc_b_channel.gpio_num);
-            ledc_channel_config(&ledc_b_channel);
-        }
+static void handle_sync(uint32_t source_ip, int64_t rx_time_us)
+{
+    if (sync_timeout_ms <= 0 || source_ip != dmx_source_ip) {
+        return;
+    }
+
+    if (!synchronous) {
+        ESP_LOGI(TAG, "ArtSync received, entering synchronous mode");
+        synchronous = true;
+        send_diag(DIAG_MEDIUM, "ArtSync received, entering synchronous mode");
+        node_changed();
     }
+    last_sync_time = rx_time_us;
 
-    return 0;
+    if (frame_pending) {
+        counters.syncs++;
+        timing_add(&sync_wait_timing, rx_time_us - frame_pending_since);
+        commit_frame();
+    }
 }
 
-int init(uint8_t *light_data_buf)
+// Time the pending frame has to be looked at again, 0 if nothing is pending
+static int64_t pending_deadline(void)
 {
-    int32_t val;
-    int err;
-
-    if (load_led_type(&val) == ESP_OK)
-    {
-        err = load_artnet_universe(&artnet_universe);
-        if (err) {
-            ESP_LOGW(TAG, "No artnet universe configured, defaulting to 0");
-            artnet_universe = 0;
-        }
-        err = load_artnet_first_channel(&artnet_first_channel);
-        if (err) {
-            ESP_LOGW(TAG, "No artnet first channel configured, bailing");
-            return err;
+    if (!frame_pending) {
+        return 0;
+    }
+    if (synchronous) {
+        return last_sync_time + sync_timeout_ms * 1000LL;
+    }
+    return frame_pending_since + FRAME_DEADLINE_MS * 1000LL;
+}
+
+// Called after the socket has been drained or a deadline passed
+static void flush_pending(void)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (synchronous && now - last_sync_time > sync_timeout_ms * 1000LL) {
+        ESP_LOGI(TAG, "No ArtSync for %"PRId32" ms, back to immediate output", sync_timeout_ms);
+        synchronous = false;
+        send_diag(DIAG_MEDIUM, "No ArtSync for %"PRId32" ms, back to immediate output", sync_timeout_ms);
+        node_changed();
+    }
+
+    if (reply_pending) {
+        reply_pending = false;
+        send_poll_replies(poller.ip, false, 0, 0);
+    }
+
+    if (!frame_pending || synchronous) {
+        return;
+    }
+
+    if (frame_universes == all_universes) {
+        commit_frame();
+    } else if (now - frame_pending_since >= FRAME_DEADLINE_MS * 1000LL) {
+        counters.incomplete++;
+        if (now - last_incomplete_diag >= INCOMPLETE_DIAG_INTERVAL_MS * 1000LL) {
+            last_incomplete_diag = now;
+            send_diag(DIAG_LOW, "Frame output with universes missing, mask %02"PRIx32" of %02"PRIx32,
+                    frame_universes, all_universes);
         }
+        commit_frame();
+    }
+}
+
+enum packet_class artnet_classify(const uint8_t *buf, size_t len)
+{
+    // Shortest packet we use is ArtPoll
+    if (len < 13 || memcmp(buf, ARTNET_MAGIC_HEADER, ARTNET_MAGIC_HEADER_LEN) != 0) {
+        return PACKET_INVALID;
+    }
 
-        led_type = (enum led_type) val;
-        if (led_type == LED_STRIP)
-        {
-            ESP_LOGI(TAG, "Initializing a led strip");
-            return init_led_strip();
+    uint16_t opcode = buf[8] | buf[9] << 8;
+    uint16_t protver = buf[10] << 8 | buf[11];
+
+    switch (opcode) {
+    case OPCODE_DMX:
+        if (protver != PROTOCOL_VERSION || len < 18) {
+            return PACKET_INVALID;
         }
-        else if (led_type == LED_RGB)
-        {
-            ESP_LOGI(TAG, "Initializing a single rgb led");
-            return init_led_rgb();
+        uint16_t universe = 0x7fff & (buf[14] | buf[15] << 8);
+        unsigned int index = universe - artnet_universe;
+        if (universe < artnet_universe || index >= universe_count
+                || !(all_universes & 1u << index)) {
+            return PACKET_FOREIGN;
         }
-        else
-        {
-            ESP_LOGI(TAG, "No leds");
+        // Header is 18 bytes
+        uint16_t datalen = buf[16] << 8 | buf[17];
+        if (datalen != len - 18) {
+            return PACKET_INVALID;
         }
+        return PACKET_DMX;
+    case OPCODE_SYNC:
+        return protver == PROTOCOL_VERSION ? PACKET_SYNC : PACKET_INVALID;
+    case OPCODE_POLL:
+        // Polls are accepted from any later protocol version too
+        return protver >= PROTOCOL_VERSION ? PACKET_POLL : PACKET_INVALID;
+    default:
+        return PACKET_OTHER;
     }
-    else
-    {
-        led_type = LED_NONE;
-    }
-    return 0;
 }
 
-struct led_rgbi {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t i;
-};
-
-
-// TODO: respond to poll
-bool handle_artnet(uint8_t *artnet_buf, size_t artnet_buf_len)
+// Returns false if the frame is a duplicate or older than the last one
+static bool check_sequence(unsigned int index, uint8_t seq, int64_t rx_time_us)
 {
-    //ESP_LOGI(TAG, "received something on artnet");
-    if (artnet_buf_len < 13)
-    {
-        ESP_LOGW(TAG, "packet too short");
-        // Shortest packet is probably ArtPoll
+    uint8_t last = sequence[index].last;
+    sequence[index].last = seq;
+    if (seq == 0 || last == 0) {
+        sequence[index].late_streak = 0;
+        return true;
+    }
+
+    // Distance forward from the last frame in the 1-255 cycle
+    unsigned int ahead = (seq + 255 - last) % 255;
+    if (ahead == 0) {
+        sequence[index].duplicates++;
         return false;
     }
+    if (ahead < 128) {
+        sequence[index].missing += ahead - 1;
+        sequence[index].late_streak = 0;
+        return true;
+    }
 
-    if (memcmp(artnet_buf, ARTNET_MAGIC_HEADER, ARTNET_MAGIC_HEADER_LEN) != 0)
-    {
-        ESP_LOGW(TAG, "incorrect magic value");
-        // Not an artnet packet
+    if (sequence[index].late_streak < SEQUENCE_RESYNC_FRAMES
+            && rx_time_us - universe_rx_time[index] < SEQUENCE_RESYNC_MS * 1000LL) {
+        sequence[index].late_streak++;
+        sequence[index].reordered++;
+        sequence[index].last = last;
         return false;
     }
+    sequence[index].late_streak = 0;
+    return true;
+}
 
-    uint16_t opcode = artnet_buf[8] | artnet_buf[9] << 8;
-    uint16_t protver = artnet_buf[10] << 8 | artnet_buf[11];
+static void handle_dmx(const uint8_t *buf, size_t len, uint32_t source_ip, int64_t rx_time_us)
+{
+    uint8_t seq = buf[12];
+    //uint8_t phys = buf[13];
+    uint16_t universe = 0x7fff & (buf[14] | buf[15] << 8);
+    unsigned int index = universe - artnet_universe;
 
-    if (opcode == 0x5000)
-    {
-        if (protver != 14)
-        {
-            ESP_LOGW(TAG, "Protocol version is not 14, is %d", protver);
-            return false;
-        }
-        //ESP_LOGI(TAG, "was light opcode");
-        //uint8_t seq = (uint8_t)artnet_buf[12];
-        //uint8_t phys = (uint8_t)artnet_buf[13];
-        uint16_t universe = 0x7fff & (artnet_buf[14] | artnet_buf[15] << 8);
-        uint16_t datalen = artnet_buf[16] << 8 | artnet_buf[17];
-
-        if (datalen != artnet_buf_len - 18)
-        {
-            // Header is 18 bytes
-            ESP_LOGW(TAG, "packet content length does not match header data");
-            return false;
-        }
+    if (!check_sequence(index, seq, rx_time_us)) {
+        return;
+    }
 
-        if (universe == artnet_universe)
-        {
-            //ESP_LOGI(TAG, "correct universe");
-            if (led_type == LED_STRIP)
-            {
-                ESP_LOGI(TAG, "doing ledstrip with count %"PRIu32, strip_config.max_leds);
-                for (int i = 0; i < strip_config.max_leds; i++)
-                {
-                    struct led_rgbi *led = i + ((struct led_rgbi*) &artnet_buf[18 + artnet_first_channel]);
-                    uint8_t r = (led->r * led->i) >> 8;
-                    uint8_t g = (led->g * led->i) >> 8;
-                    uint8_t b = (led->b * led->i) >> 8;
-                    led_strip_set_pixel(led_strip, i, r, g, b);
-                }
-                led_strip_refresh(led_strip);
-            }
-            else if (led_type == LED_RGB)
-            {
-                struct led_rgbi *led = ((struct led_rgbi*) &artnet_buf[18 + artnet_first_channel]);
-                uint32_t r = led->r * led->i;
-                uint32_t g = led->g * led->i;
-                uint32_t b = led->b * led->i;
-                r >>= 8;
-                g >>= 8;
-                b >>= 8;
-                //ESP_LOGI(TAG, "doing single led, %.2"PRId32" %.2"PRId32" %.2"PRId32, r, g, b);
-                ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_G, g);
-                ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_B, b);
-                ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_R, r);
-                ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_G);
-                ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_B);
-                ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_R);
-            }
-        }
+    counters.received++;
+    if (rx_time_us - universe_rx_time[index] >= PORT_ACTIVE_MS * 1000LL) {
+        // Data started flowing on the port
+        node_changed();
     }
-    else
-    {
-        ESP_LOGD(TAG, "Unknown packet opcode %04x", opcode);
+    universe_rx_time[index] = rx_time_us;
+    if (render_write(index, &buf[18], len - 18, rx_time_us)) {
+        counters.coalesced++;
     }
-    vTaskDelay(5);
-    return true;
-};
+    frame_universes |= 1u << index;
+    if (!frame_pending) {
+        frame_pending = true;
+        frame_pending_since = rx_time_us;
+    }
+    dmx_source_ip = source_ip;
+}
 
-// This will block for one second
-static void show_ready(void)
+// Packets artnet_classify() did not drop
+static void handle_artnet(enum packet_class class, const uint8_t *buf, size_t len,
+        uint32_t source_ip, int64_t rx_time_us)
 {
-    if (led_type == LED_STRIP)
-    {
-        led_strip_set_pixel(led_strip, 0, 0, 200, 0);
-        led_strip_refresh(led_strip);
-        vTaskDelay(pdMS_TO_TICKS(500));
-        led_strip_set_pixel(led_strip, 0, 0, 0, 0);
-        led_strip_refresh(led_strip);
-    }
-    else
-    {
-        ESP_LOGW(TAG, "No ledstrip for showing ready state");
+    switch (class) {
+    case PACKET_DMX:
+        handle_dmx(buf, len, source_ip, rx_time_us);
+        break;
+    case PACKET_SYNC:
+        handle_sync(source_ip, rx_time_us);
+        break;
+    case PACKET_POLL:
+        handle_poll(buf, len, source_ip);
+        break;
+    default:
+        break;
     }
 }
 
-static void artnet_worker(void *bogus)
+static void count_drop(enum packet_class class)
 {
-    show_ready();
+    switch (class) {
+    case PACKET_FOREIGN:
+        drops.foreign++;
+        break;
+    case PACKET_OTHER:
+        drops.other++;
+        break;
+    default:
+        drops.invalid++;
+        break;
+    }
+}
 
+static void artnet_worker(void *bogus)
+{
     // IPv4 isn't too long for this
     //char addr_str[32];
     uint8_t rx_buffer[2048];
@@ -316,6 +613,12 @@ static void artnet_worker(void *bogus)
 
     ESP_LOGI(TAG, "Socket created");
 
+    // Diagnostics may be broadcast
+    int broadcast = 1;
+    if (setsockopt(listen_sock, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast)) != 0) {
+        ESP_LOGW(TAG, "Unable to enable broadcast: errno %d", errno);
+    }
+
     int err = bind(listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
     if (err != 0) {
         ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
@@ -324,6 +627,7 @@ static void artnet_worker(void *bogus)
         goto CLEAN_UP;
     }
     ESP_LOGI(TAG, "Socket bound, port %d", PORT);
+    sock = listen_sock;
 
     while (1) {
 
@@ -331,6 +635,17 @@ static void artnet_worker(void *bogus)
 
         //assert(state == STATE_IDLE);
 
+        int ready = socket_wait(listen_sock, pending_deadline());
+        if (ready < 0) {
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
+            break;
+        }
+        if (ready == 0) {
+            // A partial frame or the ArtSync wait timed out
+            flush_pending();
+            continue;
+        }
+
         struct sockaddr_storage source_addr;
         socklen_t addr_len = sizeof(source_addr);
 
@@ -350,10 +665,38 @@ static void artnet_worker(void *bogus)
         //ESP_LOGI(TAG, "data from address: %s", addr_str);
 
 
-        handle_artnet(rx_buffer, recv_len);
+        // After a stall the socket may hold a burst of packets. Drain
+        // everything pending so only the newest frame gets rendered,
+        // the older ones are overwritten in the back buffer.
+        for (int drained = 0; recv_len >= 0; drained++) {
+            enum packet_class class = artnet_classify(rx_buffer, recv_len);
+            if (class >= PACKET_FOREIGN) {
+                count_drop(class);
+            } else {
+                int64_t rx_time = esp_timer_get_time();
+                uint32_t source_ip = ((struct sockaddr_in *)&source_addr)->sin_addr.s_addr;
+                handle_artnet(class, rx_buffer, recv_len, source_ip, rx_time);
+                timing_add(&parse_timing, esp_timer_get_time() - rx_time);
+            }
+
+            if (drained == MAX_DRAIN_PACKETS) {
+                break;
+            }
+            addr_len = sizeof(source_addr);
+            recv_len = recvfrom(listen_sock, rx_buffer, sizeof(rx_buffer) -1, MSG_DONTWAIT,
+                    (struct sockaddr*) &source_addr, &addr_len);
+        }
+
+        if (recv_len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            break;
+        }
+
+        flush_pending();
     }
 
 CLEAN_UP:
+    sock = -1;
     close(listen_sock);
     vTaskDelete(NULL);
 }
@@ -363,9 +706,32 @@ static StaticTask_t xTaskBuffer;
 static StackType_t xStack[ STACK_SIZE ];
 static TaskHandle_t task_handle = NULL;
 
+void artnet_print_stats(void)
+{
+    printf("frames received: %"PRIu32", coalesced: %"PRIu32"\n",
+            counters.received, counters.coalesced);
+    printf("synchronous: %s, frames latched by ArtSync: %"PRIu32"\n",
+            synchronous ? "yes" : "no", counters.syncs);
+    printf("universes: %u, frames output incomplete: %"PRIu32"\n",
+            universe_count, counters.incomplete);
+    printf("name: %s, polls: %"PRIu32", replies: %"PRIu32", diagnostics sent: %"PRIu32"\n",
+            node_name, counters.polls, counters.replies, counters.diags);
+    printf("dropped, foreign universe: %"PRIu32", other opcode: %"PRIu32", invalid: %"PRIu32"\n",
+            drops.foreign, drops.other, drops.invalid);
+    for (unsigned int i = 0; i < universe_count; i++) {
+        if (!(all_universes & 1u << i)) {
+            continue;
+        }
+        printf("universe %"PRId32" sequence, reordered: %"PRIu32", duplicate: %"PRIu32", missing: %"PRIu32"\n",
+                artnet_universe + i, sequence[i].reordered, sequence[i].duplicates, sequence[i].missing);
+    }
+    timing_print("parse", &parse_timing);
+    timing_print("sync wait", &sync_wait_timing);
+}
+
 void artnet_task_start(void)
 {
-    init(NULL);
+    init();
     /*while(state != STATE_IDLE) {
         // Wait for wifi task to connect to a network
         vTaskDelay(pdMS_TO_TICKS(100));
@@ -378,6 +744,7 @@ void artnet_task_start(void)
             STACK_SIZE,
             (void*) 0,
             //tskIDLE_PRIORITY,
+            // Above the render task, receiving must not wait for the leds
             5,
             xStack,
             &xTaskBuffer
@@ -2,6 +2,30 @@
 #ifndef _ARTNET_H
 #define _ARTNET_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 void artnet_task_start(void);
 
+void artnet_print_stats(void);
+
+/*
+ * Classes of received packets. Everything from PACKET_FOREIGN
+ * on is dropped without further parsing.
+ */
+enum packet_class {
+    PACKET_DMX,
+    PACKET_SYNC,
+    PACKET_POLL,
+    PACKET_FOREIGN,     // ArtDmx of a universe no strip reads
+    PACKET_OTHER,       // Art-Net we have no use for
+    PACKET_INVALID,     // not Art-Net or malformed
+};
+
+/*
+ * Sort a packet by its first 18 bytes, so the universes of other
+ * devices on a busy network are rejected as early as possible.
+ */
+enum packet_class artnet_classify(const uint8_t *buf, size_t len);
+
 #endif
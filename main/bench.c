@@ -0,0 +1,197 @@
+#include "bench.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+#include "artnet.h"
+#include "mapping.h"
+#include "pixel.h"
+#include "render.h"
+#include "util.h"
+
+#define BENCH_PIXELS 1000
+#define BENCH_ROUNDS 20
+#define BENCH_FRAMES 200
+// Universes on the network in the art-net replay, all but one foreign
+#define BENCH_UNIVERSES 32
+
+static void print_result(const char *name, int64_t us, uint32_t items)
+{
+    printf("%-12s %"PRId64" ns/pixel\n", name, us * 1000 / items);
+}
+
+// Frames on the wire with the RMT DMA and memory block settings in use
+static int bench_rmt(void)
+{
+    return render_bench_refresh(BENCH_FRAMES);
+}
+
+// Input pixel decoding per mode and mapping, ready for the strip transform
+static int bench_decode(void)
+{
+    // Room for the widest pixel, rgbw with intensity
+    const size_t pixel_size = 5;
+    uint8_t *in = malloc(BENCH_PIXELS * pixel_size);
+    uint8_t *out = malloc(BENCH_PIXELS * pixel_size);
+    uint8_t (*palette)[3] = malloc(PIXEL_PALETTE_SIZE * 3);
+    if (!in || !out || !palette) {
+        printf("Out of memory\n");
+        free(in);
+        free(out);
+        free(palette);
+        return 1;
+    }
+    for (uint32_t i = 0; i < BENCH_PIXELS * pixel_size; i++) {
+        in[i] = rand();
+    }
+    pixel_default_palette(palette);
+
+    const struct {
+        const char *name;
+        enum pixel_input input;
+        uint32_t group;
+        const char *mapping;
+    } modes[] = {
+        { "rgbi", PIXEL_INPUT_RGBI, 1, "" },
+        { "rgbi x4", PIXEL_INPUT_RGBI, 4, "" },
+        { "rgbi matrix", PIXEL_INPUT_RGBI, 1, "width=16 serpentine reverse" },
+        { "rgbwi", PIXEL_INPUT_RGBI, 1, "in=rgbwi mirror" },
+        { "palette", PIXEL_INPUT_PALETTE, 1, "" },
+        { "palette x4", PIXEL_INPUT_PALETTE, 4, "" },
+        { "hsv", PIXEL_INPUT_HSV, 1, "" },
+        { "hsv x4", PIXEL_INPUT_HSV, 4, "" },
+    };
+
+    for (int m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        struct mapping mapping;
+        struct pixel_map map;
+        if (mapping_parse(modes[m].mapping, &mapping) != ESP_OK
+                || mapping_compile(&mapping, modes[m].input, BENCH_PIXELS, modes[m].group, &map) != ESP_OK) {
+            printf("%-12s failed\n", modes[m].name);
+            continue;
+        }
+        int64_t start = esp_timer_get_time();
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            pixel_decode(&map, (const uint8_t (*)[3]) palette, in, out, BENCH_PIXELS);
+        }
+        print_result(modes[m].name, esp_timer_get_time() - start, BENCH_ROUNDS * BENCH_PIXELS);
+        mapping_free(&map);
+    }
+
+    free(in);
+    free(out);
+    free(palette);
+    return 0;
+}
+
+/*
+ * The receive path as it was before artnet_classify(): every packet was
+ * timestamped and fully checked, and only then was its universe looked at.
+ */
+static bool artnet_reference(const uint8_t *buf, size_t len, int32_t first,
+        unsigned int count, struct timing *parse)
+{
+    int64_t rx_time = esp_timer_get_time();
+    bool ours = false;
+    if (len >= 13 && memcmp(buf, "Art-Net\0", 8) == 0) {
+        uint16_t opcode = buf[8] | buf[9] << 8;
+        uint16_t protver = buf[10] << 8 | buf[11];
+        if (opcode == 0x5000 && protver == 14 && len >= 18) {
+            uint16_t universe = 0x7fff & (buf[14] | buf[15] << 8);
+            uint16_t datalen = buf[16] << 8 | buf[17];
+            if (datalen == len - 18) {
+                ours = universe >= first && universe < first + count;
+            }
+        }
+    }
+    timing_add(parse, esp_timer_get_time() - rx_time);
+    return ours;
+}
+
+/*
+ * Replay a busy network of full ArtDmx universes, one of them ours,
+ * through the old receive checks and the header classifier.
+ */
+static int bench_classify(void)
+{
+    const size_t len = 18 + DMX_UNIVERSE_SIZE;
+    uint8_t *packets = calloc(BENCH_UNIVERSES, len);
+    if (!packets) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    int32_t first = render_first_universe();
+    for (int i = 0; i < BENCH_UNIVERSES; i++) {
+        uint8_t *p = &packets[i * len];
+        // Ours is first, the rest are above any universe we could read
+        uint16_t universe = i == 0 ? first : first + RENDER_MAX_UNIVERSES + i;
+        memcpy(p, "Art-Net\0", 8);
+        p[8] = 0x00;
+        p[9] = 0x50;
+        p[11] = 14;
+        p[14] = universe & 0xff;
+        p[15] = universe >> 8;
+        p[16] = DMX_UNIVERSE_SIZE >> 8;
+        p[17] = DMX_UNIVERSE_SIZE & 0xff;
+    }
+
+    struct timing parse = {0};
+    unsigned int ours = 0;
+    int64_t start = esp_timer_get_time();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int i = 0; i < BENCH_UNIVERSES; i++) {
+            ours += artnet_reference(&packets[i * len], len, first, render_universe_count(), &parse);
+        }
+    }
+    int64_t reference_us = esp_timer_get_time() - start;
+
+    unsigned int kept = 0;
+    start = esp_timer_get_time();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int i = 0; i < BENCH_UNIVERSES; i++) {
+            kept += artnet_classify(&packets[i * len], len) < PACKET_FOREIGN;
+        }
+    }
+    int64_t classify_us = esp_timer_get_time() - start;
+
+    uint32_t n = BENCH_ROUNDS * BENCH_UNIVERSES;
+    printf("%-12s %"PRId64" ns/packet, kept %u\n", "reference", reference_us * 1000 / n, ours);
+    printf("%-12s %"PRId64" ns/packet, kept %u\n", "classify", classify_us * 1000 / n, kept);
+
+    free(packets);
+    return 0;
+}
+
+static const struct {
+    const char *name;
+    int (*fn)(void);
+    const char *help;
+} benchmarks[] = {
+    { "rmt", bench_rmt, "strip wire time and late frames, run under wifi load" },
+    { "decode", bench_decode, "input pixel decoding per input mode and grouping" },
+    { "classify", bench_classify, "art-net receive checks on a busy network, old against classifier" },
+};
+
+int bench_run(const char *name)
+{
+    for (int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (strcmp(name, benchmarks[i].name) == 0) {
+            return benchmarks[i].fn();
+        }
+    }
+    printf("Unknown benchmark %s\n", name);
+    bench_print_names();
+    return 1;
+}
+
+void bench_print_names(void)
+{
+    for (int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        printf("%-10s %s\n", benchmarks[i].name, benchmarks[i].help);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+/*
+ * On device micro benchmarks, run from the console.
+ * They use the configured hardware, so the leds may
+ * show garbage while a benchmark runs. The hardware
+ * independent benchmarks are in host_test/.
+ */
+int bench_run(const char *name);
+
+void bench_print_names(void);
+
+#endif
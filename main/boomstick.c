@@ -11,7 +11,10 @@
 #include "battery.h"
 #include "config.h"
 #include "console.h"
+#include "ddp.h"
 #include "npp.h"
+#include "render.h"
+#include "sacn.h"
 #include "util.h"
 #include "wifi.h"
 
@@ -195,7 +198,10 @@ void app_main(void)
 
     battery_timer_start();
 
+    render_task_start();
     artnet_task_start();
+    sacn_task_start();
+    ddp_task_start();
 
     unsigned int last_time_button_sent = 0;
 
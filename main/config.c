@@ -1,3 +1,7 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "common.h"
 #include "config.h"
 #include "nvs.h"
@@ -80,6 +84,42 @@ static int nvs_get_key_value_i32(const char* key, int32_t *val)
     return 0;
 }
 
+static int nvs_set_key_value_blob(const char* key, const void* val, size_t len)
+{
+    nvs_handle_t nvs;
+    int err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err)
+    {
+        return -1;
+    }
+
+    err = nvs_set_blob(nvs, key, val, len);
+    nvs_close(nvs);
+    if (err)
+    {
+        return -2;
+    }
+    return 0;
+}
+
+static int nvs_get_key_value_blob(const char* key, void* val, size_t* len)
+{
+    nvs_handle_t nvs;
+    int err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err)
+    {
+        return -1;
+    }
+
+    err = nvs_get_blob(nvs, key, val, len);
+    nvs_close(nvs);
+    if (err)
+    {
+        return -2;
+    }
+    return 0;
+}
+
 int save_ssid(const char* ssid)
 {
     return nvs_set_key_value_str(NVS_KEY_SSID, ssid);
@@ -95,6 +135,11 @@ int save_broker_uri(const char* broker)
     return nvs_set_key_value_str(NVS_KEY_BROKER_URI, broker);
 }
 
+int save_node_name(const char* name)
+{
+    return nvs_set_key_value_str(NVS_KEY_NODE_NAME, name);
+}
+
 int load_ssid(uint8_t* ssid)
 {
     size_t len = MAX_WIFI_SSID_LEN;
@@ -113,6 +158,12 @@ int load_broker_uri(uint8_t* broker)
     return nvs_get_key_value_str(NVS_KEY_BROKER_URI, (char*) broker, &len);
 }
 
+int load_node_name(char* name)
+{
+    size_t len = MAX_NODE_NAME_LEN + 1;
+    return nvs_get_key_value_str(NVS_KEY_NODE_NAME, name, &len);
+}
+
 
 /*
 int save_artnet_universe(int32_t universe)
@@ -193,3 +244,156 @@ int load_ledc_pins(int32_t* rpin, int32_t* gpin, int32_t* bpin)
 
     return ret;
 }
+
+int save_strip_map(int index, const char* map)
+{
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_MAP, index);
+    return nvs_set_key_value_str(key, map);
+}
+
+int load_strip_map(int index, char* map)
+{
+    char key[16];
+    size_t len = MAX_STRIP_MAP_LEN + 1;
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_MAP, index);
+    return nvs_get_key_value_str(key, map, &len);
+}
+
+int save_strip_settings(int index, const struct strip_settings* settings)
+{
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_GAMMA, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->gamma));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_DITHER, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->dither));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_INPUT, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->input));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_GROUP, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->group));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_MODEL, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->model));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_CLOCK_PIN, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->clock_pin));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_CLOCK_KHZ, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->clock_khz));
+
+    if (index == 0)
+    {
+        RETURN_ON_ERR(save_artnet_universe(settings->universe));
+        RETURN_ON_ERR(save_artnet_first_channel(settings->first_channel));
+        RETURN_ON_ERR(save_strip_led_count(settings->led_count));
+        return save_strip_pin(settings->pin);
+    }
+
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_UNIVERSE, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->universe));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_CHANNEL, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->first_channel));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_LED_COUNT, index);
+    RETURN_ON_ERR(nvs_set_key_value_i32(key, settings->led_count));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_PIN, index);
+    return nvs_set_key_value_i32(key, settings->pin);
+}
+
+int load_strip_settings(int index, struct strip_settings* settings)
+{
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_GAMMA, index);
+    if (nvs_get_key_value_i32(key, &settings->gamma))
+    {
+        settings->gamma = 0;
+    }
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_DITHER, index);
+    if (nvs_get_key_value_i32(key, &settings->dither))
+    {
+        settings->dither = 0;
+    }
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_INPUT, index);
+    if (nvs_get_key_value_i32(key, &settings->input))
+    {
+        settings->input = 0;
+    }
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_GROUP, index);
+    if (nvs_get_key_value_i32(key, &settings->group))
+    {
+        settings->group = 1;
+    }
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_MODEL, index);
+    if (nvs_get_key_value_i32(key, &settings->model))
+    {
+        settings->model = STRIP_WS2812;
+    }
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_CLOCK_PIN, index);
+    if (nvs_get_key_value_i32(key, &settings->clock_pin))
+    {
+        settings->clock_pin = -1;
+    }
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_CLOCK_KHZ, index);
+    if (nvs_get_key_value_i32(key, &settings->clock_khz))
+    {
+        settings->clock_khz = 0;
+    }
+
+    if (index == 0)
+    {
+        if (load_artnet_universe(&settings->universe))
+        {
+            settings->universe = 0;
+        }
+        RETURN_ON_ERR(load_artnet_first_channel(&settings->first_channel));
+        RETURN_ON_ERR(load_strip_led_count(&settings->led_count));
+        return load_strip_pin(&settings->pin);
+    }
+
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_UNIVERSE, index);
+    RETURN_ON_ERR(nvs_get_key_value_i32(key, &settings->universe));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_CHANNEL, index);
+    RETURN_ON_ERR(nvs_get_key_value_i32(key, &settings->first_channel));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_LED_COUNT, index);
+    RETURN_ON_ERR(nvs_get_key_value_i32(key, &settings->led_count));
+    snprintf(key, sizeof(key), NVS_KEY_STRIP_N_PIN, index);
+    return nvs_get_key_value_i32(key, &settings->pin);
+}
+
+int save_loss_scene(const uint8_t* scene, size_t len)
+{
+    return nvs_set_key_value_blob(NVS_KEY_LOSS_SCENE, scene, len);
+}
+
+int load_loss_scene(uint8_t* scene, size_t len)
+{
+    size_t stored = 0;
+    // Query the size first, a blob longer than len can not be read
+    RETURN_ON_ERR(nvs_get_key_value_blob(NVS_KEY_LOSS_SCENE, NULL, &stored));
+    if (stored > len)
+    {
+        uint8_t* buf = malloc(stored);
+        if (!buf)
+        {
+            return -1;
+        }
+        int err = nvs_get_key_value_blob(NVS_KEY_LOSS_SCENE, buf, &stored);
+        memcpy(scene, buf, len);
+        free(buf);
+        return err;
+    }
+    memset(scene + stored, 0, len - stored);
+    return nvs_get_key_value_blob(NVS_KEY_LOSS_SCENE, scene, &stored);
+}
+
+int save_palette(const uint8_t* palette, size_t len)
+{
+    return nvs_set_key_value_blob(NVS_KEY_PALETTE, palette, len);
+}
+
+int load_palette(uint8_t* palette, size_t len)
+{
+    size_t stored = 0;
+    RETURN_ON_ERR(nvs_get_key_value_blob(NVS_KEY_PALETTE, NULL, &stored));
+    if (stored != len)
+    {
+        return -1;
+    }
+    return nvs_get_key_value_blob(NVS_KEY_PALETTE, palette, &stored);
+}
@@ -1,6 +1,7 @@
 #ifndef _CONFIG_H
 #define _CONFIG_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define NVS_NAMESPACE "storage"
@@ -8,24 +9,77 @@
 #define NVS_KEY_SSID "SSID"
 #define NVS_KEY_PASS "PASS"
 #define NVS_KEY_BROKER_URI "BROKER"
+#define NVS_KEY_NODE_NAME "NODE_NAME"
 
 #define NVS_KEY_ARTNET_UNIVERSE "UNIVERSE"
 #define NVS_KEY_ARTNET_FIRST_CHANNEL "CHANNEL"
+#define NVS_KEY_ARTNET_SYNC_TIMEOUT "SYNC_TIMEOUT"
+
+#define NVS_KEY_RENDER_RATE "RENDER_RATE"
+#define NVS_KEY_RENDER_KEEPALIVE "KEEPALIVE"
+
+// What to show when frames stop arriving
+#define NVS_KEY_LOSS_TIMEOUT "LOSS_TIMEOUT"
+#define NVS_KEY_LOSS_POLICY "LOSS_POLICY"
+#define NVS_KEY_LOSS_FADE "LOSS_FADE"
+#define NVS_KEY_LOSS_SCENE "LOSS_SCENE"
 
 #define NVS_KEY_LED_TYPE "LED_TYPE"
 
 #define NVS_KEY_STRIP_LED_COUNT "LED_COUNT"
 #define NVS_KEY_STRIP_PIN "LED_PIN_1"
 
+// Keys of the additional strips, %d is the strip index
+#define NVS_KEY_STRIP_N_UNIVERSE "S%d_UNIVERSE"
+#define NVS_KEY_STRIP_N_CHANNEL "S%d_CHANNEL"
+#define NVS_KEY_STRIP_N_LED_COUNT "S%d_COUNT"
+#define NVS_KEY_STRIP_N_PIN "S%d_PIN"
+// Output processing, these keys are used for strip 0 too
+#define NVS_KEY_STRIP_N_GAMMA "S%d_GAMMA"
+#define NVS_KEY_STRIP_N_DITHER "S%d_DITHER"
+#define NVS_KEY_STRIP_N_INPUT "S%d_INPUT"
+#define NVS_KEY_STRIP_N_GROUP "S%d_GROUP"
+#define NVS_KEY_STRIP_N_MAP "S%d_MAP"
+// Led chip and the clock line of clocked strips
+#define NVS_KEY_STRIP_N_MODEL "S%d_MODEL"
+#define NVS_KEY_STRIP_N_CLOCK_PIN "S%d_CLK_PIN"
+#define NVS_KEY_STRIP_N_CLOCK_KHZ "S%d_CLK_KHZ"
+
+// Colors of the palette input mode, shared by all strips
+#define NVS_KEY_PALETTE "PALETTE"
+
+// RMT channel setup shared by all strips
+#define NVS_KEY_RMT_DMA "RMT_DMA"
+#define NVS_KEY_RMT_MEM_SYMBOLS "RMT_MEM_SYMS"
+
 #define NVS_KEY_LED_R_PIN "LED_PIN_1"
 #define NVS_KEY_LED_G_PIN "LED_PIN_2"
 #define NVS_KEY_LED_B_PIN "LED_PIN_3"
+// PWM of the single rgb led
+#define NVS_KEY_LEDC_FREQ "LEDC_FREQ"
+#define NVS_KEY_LEDC_WIDE "LEDC_WIDE"
+#define NVS_KEY_LEDC_GAMMA "LEDC_GAMMA"
+#define NVS_KEY_LEDC_FADE "LEDC_FADE"
 
 #define NVS_KEY_BUTTON_PIN "BUTTON_PIN"
 
 #define MAX_WIFI_SSID_LEN 32
 #define MAX_WIFI_PASS_LEN 64
 #define MAX_BROKER_URI_LEN 32
+// Fits the ArtPollReply long name with its terminating zero
+#define MAX_NODE_NAME_LEN 63
+#define MAX_STRIP_MAP_LEN 95
+
+// Each strip is driven by its own RMT channel, or SPI bus if clocked
+#define MAX_LED_STRIPS 4
+
+// Led chips of a strip, the clocked ones are driven over SPI
+enum strip_model {
+    STRIP_WS2812 = 0,
+    STRIP_APA102,
+    STRIP_SK9822,
+    STRIP_MODEL_COUNT
+};
 
 enum led_type {
 	LED_NONE,
@@ -55,6 +109,14 @@ int load_ssid(uint8_t* ssid);
 int load_pass(uint8_t* pass);
 int load_broker_uri(uint8_t* broker);
 
+/*
+ * Name the device announces itself with, e.g. in ArtPollReply.
+ * name : max len 63, load_node_name() needs room for the terminator
+ * return 0 on success
+ */
+int save_node_name(const char* name);
+int load_node_name(char* name);
+
 //int save_led_strip_type(const enum led_type* led_type);
 
 #define INT_CONFIG(fn_name, key) \
@@ -84,4 +146,65 @@ int load_##fn_name (int32_t* val);
 //
 int load_ledc_pins(int32_t* rpin, int32_t* gpin, int32_t* bpin);
 
+enum loss_policy {
+    LOSS_HOLD = 0,  // keep showing the last frame
+    LOSS_FADE,      // fade to black
+    LOSS_SCENE,     // fade to the stored scene
+};
+
+/*
+ * The loss scene is a snapshot of the frame buffer.
+ * load_loss_scene() fills at most len bytes and zeroes the rest,
+ * if the stored scene is shorter than the frame.
+ * return 0 on success
+ */
+int save_loss_scene(const uint8_t* scene, size_t len);
+int load_loss_scene(uint8_t* scene, size_t len);
+
+/*
+ * The palette is 256 RGB entries.
+ * load_palette() fails if a palette of another size is stored.
+ * return 0 on success
+ */
+int save_palette(const uint8_t* palette, size_t len);
+int load_palette(uint8_t* palette, size_t len);
+
+/*
+ * Pixel mapping of a strip, see mapping.h.
+ * map : max len 95, load_strip_map() needs room for the terminator
+ * return 0 on success
+ */
+int save_strip_map(int index, const char* map);
+int load_strip_map(int index, char* map);
+
+struct strip_settings {
+    int32_t universe;
+    int32_t first_channel;
+    int32_t led_count;
+    int32_t pin;
+    // Gamma in tenths, 0 for the plain 8 bit output
+    int32_t gamma;
+    // Temporal dithering of the 16 bit gamma corrected output
+    int32_t dither;
+    // Slot layout of the pixels, enum pixel_input
+    int32_t input;
+    // Leds driven by each input pixel
+    int32_t group;
+    // enum strip_model
+    int32_t model;
+    // Clock line of clocked strips and its rate, 0 for the default
+    int32_t clock_pin;
+    int32_t clock_khz;
+};
+
+/*
+ * Strip 0 uses the same keys as the single strip setup always has,
+ * strips 1 to MAX_LED_STRIPS - 1 have keys of their own.
+ * Gamma, dither, input, model and clock rate are optional and default
+ * to 0 when loading, group defaults to 1 and the clock pin to -1.
+ * return 0 on success
+ */
+int save_strip_settings(int index, const struct strip_settings* settings);
+int load_strip_settings(int index, struct strip_settings* settings);
+
 #endif
@@ -2,10 +2,22 @@
 INT_CONFIG(led_type, NVS_KEY_LED_TYPE)
 INT_CONFIG(artnet_universe, NVS_KEY_ARTNET_UNIVERSE)
 INT_CONFIG(artnet_first_channel, NVS_KEY_ARTNET_FIRST_CHANNEL)
+INT_CONFIG(artnet_sync_timeout, NVS_KEY_ARTNET_SYNC_TIMEOUT)
+INT_CONFIG(render_rate, NVS_KEY_RENDER_RATE)
+INT_CONFIG(render_keepalive, NVS_KEY_RENDER_KEEPALIVE)
+INT_CONFIG(loss_timeout, NVS_KEY_LOSS_TIMEOUT)
+INT_CONFIG(loss_policy, NVS_KEY_LOSS_POLICY)
+INT_CONFIG(loss_fade, NVS_KEY_LOSS_FADE)
 INT_CONFIG(strip_led_count, NVS_KEY_STRIP_LED_COUNT)
 INT_CONFIG(strip_pin, NVS_KEY_STRIP_PIN)
+INT_CONFIG(rmt_dma, NVS_KEY_RMT_DMA)
+INT_CONFIG(rmt_mem_symbols, NVS_KEY_RMT_MEM_SYMBOLS)
 INT_CONFIG(r_pin, NVS_KEY_LED_R_PIN)
 INT_CONFIG(g_pin, NVS_KEY_LED_G_PIN)
 INT_CONFIG(b_pin, NVS_KEY_LED_B_PIN)
+INT_CONFIG(ledc_freq, NVS_KEY_LEDC_FREQ)
+INT_CONFIG(ledc_wide, NVS_KEY_LEDC_WIDE)
+INT_CONFIG(ledc_gamma, NVS_KEY_LEDC_GAMMA)
+INT_CONFIG(ledc_fade, NVS_KEY_LEDC_FADE)
 
 INT_CONFIG(button_pin, NVS_KEY_BUTTON_PIN)
@@ -6,8 +6,17 @@
 //#include "cmd_nvs.h"
 #include "argtable3/argtable3.h"
 
+#include "artnet.h"
+#include "bench.h"
+#include "common.h"
 #include "config.h"
+#include "ddp.h"
+#include "mapping.h"
+#include "pixel.h"
+#include "render.h"
+#include "sacn.h"
 
+#include <stdbool.h>
 #include <string.h>
 
 #include "battery.h"
@@ -23,6 +32,11 @@ struct {
     struct arg_end *end;
 } broker_arg;
 
+struct {
+    struct arg_str *name;
+    struct arg_end *end;
+} name_arg;
+
 struct {
     struct arg_str *type;
     struct arg_end *end;
@@ -33,15 +47,41 @@ struct {
     struct arg_int *channel;
     struct arg_int *led_count;
     struct arg_int *data_pin;
+    struct arg_int *index;
+    struct arg_int *gamma;
+    struct arg_int *dither;
+    struct arg_str *input;
+    struct arg_int *group;
+    struct arg_str *model;
+    struct arg_int *clock_pin;
+    struct arg_int *clock_khz;
     struct arg_end *end;
 } led_strip_arg;
 
+struct {
+    struct arg_int *index;
+    struct arg_int *r;
+    struct arg_int *g;
+    struct arg_int *b;
+    struct arg_end *end;
+} palette_arg;
+
+struct {
+    struct arg_int *index;
+    struct arg_str *tokens;
+    struct arg_end *end;
+} map_arg;
+
 struct {
     struct arg_int *universe;
     struct arg_int *channel;
     struct arg_int *r_pin;
     struct arg_int *g_pin;
     struct arg_int *b_pin;
+    struct arg_int *freq;
+    struct arg_int *wide;
+    struct arg_int *gamma;
+    struct arg_int *fade;
     struct arg_end *end;
 } led_rgb_arg;
 
@@ -50,6 +90,39 @@ struct {
     struct arg_end *end;
 } button_arg;
 
+struct {
+    struct arg_int *timeout;
+    struct arg_end *end;
+} sync_arg;
+
+struct {
+    struct arg_int *rate;
+    struct arg_end *end;
+} rate_arg;
+
+struct {
+    struct arg_int *ms;
+    struct arg_end *end;
+} keepalive_arg;
+
+struct {
+    struct arg_int *timeout;
+    struct arg_str *policy;
+    struct arg_int *fade;
+    struct arg_end *end;
+} loss_arg;
+
+struct {
+    struct arg_int *dma;
+    struct arg_int *mem_symbols;
+    struct arg_end *end;
+} rmt_arg;
+
+struct {
+    struct arg_str *name;
+    struct arg_end *end;
+} bench_arg;
+
 static const char* TAG = "console";
 
 static int wifi_handler(int argc, char** argv)
@@ -116,21 +189,94 @@ static int broker_handler(int argc, char** argv)
     }
 }
 
+static int name_handler(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        char name[MAX_NODE_NAME_LEN + 1];
+        if (load_node_name(name))
+        {
+            printf("no name set, using the default\n");
+            return 0;
+        }
+        printf("current name: %s\n", name);
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &name_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, name_arg.end, argv[0]);
+        return 1;
+    }
+
+    if (strlen(name_arg.name->sval[0]) > MAX_NODE_NAME_LEN) {
+        printf("name is too long, max length is %d characters\n", MAX_NODE_NAME_LEN);
+        return 1;
+    }
+    return save_node_name(name_arg.name->sval[0]);
+}
+
+// Indexed by enum strip_model
+static const char *strip_model_names[STRIP_MODEL_COUNT] = {"ws2812", "apa102", "sk9822"};
+
+// Input pixels the stored strip reads and the slots in each
+static uint32_t strip_input_pixels(int index, const struct strip_settings *settings, unsigned int *channels)
+{
+    char text[MAX_STRIP_MAP_LEN + 1];
+    struct mapping mapping;
+    struct pixel_map map;
+    int32_t group = settings->group > 0 ? settings->group : 1;
+    if (load_strip_map(index, text) != ESP_OK || mapping_parse(text, &mapping) != ESP_OK) {
+        mapping_parse("", &mapping);
+    }
+    if (mapping_compile(&mapping, settings->input, settings->led_count, group, &map) != ESP_OK) {
+        mapping_parse("", &mapping);
+        mapping_compile(&mapping, settings->input, settings->led_count, group, &map);
+    }
+    *channels = pixel_map_channels(&map);
+    mapping_free(&map);
+    return map.pixels;
+}
+
 static int led_strip_handler(int argc, char** argv)
 {
     if (argc == 1)
     {
-        int32_t universe, first_channel, led_count, led_pin, led_type;
+        int32_t led_type;
         load_led_type(&led_type);
-        load_artnet_universe(&universe);
-        load_artnet_first_channel(&first_channel);
-        load_strip_pin(&led_pin);
-        load_strip_led_count(&led_count);
 
         if (led_type != LED_STRIP) {
             printf("WARNING! Not in STRIP led mode!\n");
         }
-        printf("artnet universe: %ld, pin: %ld, channels: %ld-%ld\n", universe, led_pin, first_channel, first_channel+ 4*led_count -1);
+        for (int i = 0; i < MAX_LED_STRIPS; i++)
+        {
+            struct strip_settings settings;
+            if (load_strip_settings(i, &settings) != ESP_OK || settings.led_count < 1) {
+                continue;
+            }
+            unsigned int channels;
+            uint32_t pixels = strip_input_pixels(i, &settings, &channels);
+            int32_t last_channel = settings.first_channel + pixels * channels - 1;
+            printf("strip %d: artnet universe: %ld, pin: %ld, channels: %ld-%ld\n", i,
+                    settings.universe, settings.pin, settings.first_channel, last_channel);
+            if (last_channel >= DMX_UNIVERSE_SIZE) {
+                printf("strip %d spans universes %ld-%ld\n", i,
+                        settings.universe, settings.universe + last_channel / DMX_UNIVERSE_SIZE);
+            }
+            if (settings.gamma > 0) {
+                printf("strip %d gamma: %ld.%ld, dithering %s\n", i, settings.gamma / 10,
+                        settings.gamma % 10, settings.dither ? "on" : "off");
+            }
+            if (settings.model != STRIP_WS2812 && settings.model < STRIP_MODEL_COUNT) {
+                printf("strip %d: %s, clock pin: %ld, %ld kHz\n", i, strip_model_names[settings.model],
+                        settings.clock_pin, settings.clock_khz > 0 ? settings.clock_khz : RENDER_CLOCKED_DEFAULT_KHZ);
+            }
+            if (settings.input != PIXEL_INPUT_RGBI || settings.group > 1) {
+                printf("strip %d input: %s, %ld leds per pixel\n", i,
+                        pixel_input_name(settings.input), settings.group);
+            }
+        }
         return 0;
     }
 
@@ -141,14 +287,81 @@ static int led_strip_handler(int argc, char** argv)
         return 1;
     }
 
+    int index = 0;
+    if (led_strip_arg.index->count > 0) {
+        index = led_strip_arg.index->ival[0];
+    }
+    if (index < 0 || index >= MAX_LED_STRIPS) {
+        printf("Strip index must be 0-%d\n", MAX_LED_STRIPS - 1);
+        return 1;
+    }
+
+    // Gamma, dithering, input, grouping and the led model are kept unless given
+    struct strip_settings settings = {.group = 1, .clock_pin = -1};
+    load_strip_settings(index, &settings);
+
+    if (led_strip_arg.input->count > 0) {
+        int input = -1;
+        for (int i = 0; i < PIXEL_INPUT_COUNT; i++) {
+            if (strcmp(led_strip_arg.input->sval[0], pixel_input_name(i)) == 0) {
+                input = i;
+            }
+        }
+        if (input < 0) {
+            printf("Input must be rgbi, palette or hsv\n");
+            return 1;
+        }
+        settings.input = input;
+    }
+    if (led_strip_arg.group->count > 0) {
+        if (led_strip_arg.group->ival[0] < 1) {
+            printf("Group must be at least 1\n");
+            return 1;
+        }
+        settings.group = led_strip_arg.group->ival[0];
+    }
+
+    if (led_strip_arg.model->count > 0) {
+        int model = -1;
+        for (int i = 0; i < STRIP_MODEL_COUNT; i++) {
+            if (strcmp(led_strip_arg.model->sval[0], strip_model_names[i]) == 0) {
+                model = i;
+            }
+        }
+        if (model < 0) {
+            printf("Model must be ws2812, apa102 or sk9822\n");
+            return 1;
+        }
+        settings.model = model;
+    }
+    if (led_strip_arg.clock_pin->count > 0) {
+        settings.clock_pin = led_strip_arg.clock_pin->ival[0];
+    }
+    if (led_strip_arg.clock_khz->count > 0) {
+        if (led_strip_arg.clock_khz->ival[0] < 0 || led_strip_arg.clock_khz->ival[0] > RENDER_CLOCKED_MAX_KHZ) {
+            printf("Clock must be 1-%d kHz, or 0 for the default\n", RENDER_CLOCKED_MAX_KHZ);
+            return 1;
+        }
+        settings.clock_khz = led_strip_arg.clock_khz->ival[0];
+    }
+    if (settings.model != STRIP_WS2812 && settings.clock_pin < 0) {
+        printf("A clocked strip needs a clock pin\n");
+        return 1;
+    }
+
     // TODO: Error checks and prints if needed
+    settings.universe = led_strip_arg.universe->ival[0];
+    settings.first_channel = led_strip_arg.channel->ival[0];
+    settings.led_count = led_strip_arg.led_count->ival[0];
+    settings.pin = led_strip_arg.data_pin->ival[0];
+    if (led_strip_arg.gamma->count > 0) {
+        settings.gamma = led_strip_arg.gamma->ival[0];
+    }
+    if (led_strip_arg.dither->count > 0) {
+        settings.dither = led_strip_arg.dither->ival[0] ? 1 : 0;
+    }
     save_led_type(LED_STRIP);
-    save_artnet_universe(led_strip_arg.universe->ival[0]);
-    save_artnet_first_channel(led_strip_arg.channel->ival[0]);
-    save_strip_led_count(led_strip_arg.led_count->ival[0]);
-    save_strip_pin(led_strip_arg.data_pin->ival[0]);
-
-    return 0;
+    return save_strip_settings(index, &settings);
 }
 
 static int led_rgb_handler(int argc, char** argv)
@@ -156,8 +369,13 @@ static int led_rgb_handler(int argc, char** argv)
     if (argc == 1)
     {
         int32_t r_pin, g_pin, b_pin, universe, first_channel, led_type;
+        int32_t freq = RENDER_LEDC_DEFAULT_FREQ, wide = 0, gamma = 0, fade = 0;
         // TODO: Print universe, first chanel and r, g and b pins
         load_led_type(&led_type);
+        load_ledc_freq(&freq);
+        load_ledc_wide(&wide);
+        load_ledc_gamma(&gamma);
+        load_ledc_fade(&fade);
         load_artnet_universe(&universe);
         load_artnet_first_channel(&first_channel);
         load_r_pin(&r_pin);
@@ -166,8 +384,15 @@ static int led_rgb_handler(int argc, char** argv)
         if (led_type != LED_RGB) {
             printf("WARNING! Not in RGB led mode!\n");
         }
-        printf("artnet universe: %ld, channels: %ld-%ld\n", universe, first_channel, first_channel+3);
+        printf("artnet universe: %ld, channels: %ld-%ld\n", universe, first_channel,
+                first_channel + (wide ? 7 : 3) + (fade ? 1 : 0));
         printf("r_pin: %ld, g_pin: %ld, b_pin: %ld\n", r_pin, g_pin, b_pin);
+        printf("pwm: %ld Hz, %d bits, %s input, gamma %ld.%ld\n", freq, render_ledc_resolution(freq),
+                wide ? "16 bit" : "8 bit", gamma > 0 ? gamma / 10 : 1, gamma > 0 ? gamma % 10 : 0);
+        if (fade) {
+            printf("hardware fades, fade time in tenths of a second on channel %ld\n",
+                    first_channel + (wide ? 8 : 4));
+        }
         return 0;
     }
 
@@ -178,6 +403,16 @@ static int led_rgb_handler(int argc, char** argv)
         return 1;
     }
 
+    // The frequency has to leave the LEDC at least 8 bits of duty
+    if (led_rgb_arg.freq->count > 0) {
+        int bits = render_ledc_resolution(led_rgb_arg.freq->ival[0]);
+        if (!bits) {
+            printf("Frequency must be %d-%d Hz\n", RENDER_LEDC_MIN_FREQ, RENDER_LEDC_MAX_FREQ);
+            return 1;
+        }
+        printf("%d Hz gives %d bits of duty\n", led_rgb_arg.freq->ival[0], bits);
+    }
+
     // TODO: Error checks and prints if needed
     save_led_type(LED_RGB);
     save_artnet_universe(led_rgb_arg.universe->ival[0]);
@@ -185,6 +420,19 @@ static int led_rgb_handler(int argc, char** argv)
     save_r_pin(led_rgb_arg.r_pin->ival[0]);
     save_g_pin(led_rgb_arg.g_pin->ival[0]);
     save_b_pin(led_rgb_arg.b_pin->ival[0]);
+    // PWM settings are kept unless given
+    if (led_rgb_arg.freq->count > 0) {
+        save_ledc_freq(led_rgb_arg.freq->ival[0]);
+    }
+    if (led_rgb_arg.wide->count > 0) {
+        save_ledc_wide(led_rgb_arg.wide->ival[0] ? 1 : 0);
+    }
+    if (led_rgb_arg.gamma->count > 0) {
+        save_ledc_gamma(led_rgb_arg.gamma->ival[0]);
+    }
+    if (led_rgb_arg.fade->count > 0) {
+        save_ledc_fade(led_rgb_arg.fade->ival[0] ? 1 : 0);
+    }
 
     return 0;
 }
@@ -213,6 +461,308 @@ static int button_handler(int argc, char** argv)
     return 0;
 }
 
+static int stats_handler(int argc, char** argv)
+{
+    artnet_print_stats();
+    sacn_print_stats();
+    ddp_print_stats();
+    render_print_stats();
+    return 0;
+}
+
+static int sync_handler(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        int32_t timeout;
+        if (load_artnet_sync_timeout(&timeout) != ESP_OK) {
+            printf("ArtSync timeout not configured, using the default\n");
+            return 0;
+        }
+        if (timeout <= 0) {
+            printf("ArtSync disabled, frames are output immediately\n");
+        } else {
+            printf("ArtSync timeout: %"PRId32" ms\n", timeout);
+        }
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &sync_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, sync_arg.end, argv[0]);
+        return 1;
+    }
+
+    save_artnet_sync_timeout(sync_arg.timeout->ival[0]);
+
+    return 0;
+}
+
+static int keepalive_handler(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        int32_t ms;
+        if (load_render_keepalive(&ms) != ESP_OK || ms < 0) {
+            printf("Skipping unchanged frames, refreshing at least every 1000 ms (default)\n");
+        } else if (ms == 0) {
+            printf("Sending every frame\n");
+        } else {
+            printf("Skipping unchanged frames, refreshing at least every %"PRId32" ms\n", ms);
+        }
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &keepalive_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, keepalive_arg.end, argv[0]);
+        return 1;
+    }
+
+    if (keepalive_arg.ms->ival[0] < 0) {
+        printf("Keepalive can't be negative\n");
+        return 1;
+    }
+    return save_render_keepalive(keepalive_arg.ms->ival[0]);
+}
+
+static int rate_handler(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        int32_t rate;
+        if (load_render_rate(&rate) != ESP_OK || rate <= 0) {
+            printf("Rendering every frame as it arrives\n");
+        } else {
+            printf("Rendering at %"PRId32" Hz, fading between frames\n", rate);
+        }
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &rate_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, rate_arg.end, argv[0]);
+        return 1;
+    }
+
+    int rate = rate_arg.rate->ival[0];
+    if (rate < 0 || rate > RENDER_MAX_RATE) {
+        printf("Rate must be 0-%d Hz\n", RENDER_MAX_RATE);
+        return 1;
+    }
+
+    return save_render_rate(rate);
+}
+
+static const char* const loss_policy_names[] = {
+    [LOSS_HOLD] = "hold",
+    [LOSS_FADE] = "fade",
+    [LOSS_SCENE] = "scene",
+};
+
+static int loss_handler(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        int32_t timeout, policy, fade;
+        if (load_loss_timeout(&timeout) != ESP_OK || timeout <= 0) {
+            printf("Stream loss watchdog disabled, the last frame stays on\n");
+            return 0;
+        }
+        if (load_loss_policy(&policy) != ESP_OK || policy < LOSS_HOLD || policy > LOSS_SCENE) {
+            policy = LOSS_HOLD;
+        }
+        if (load_loss_fade(&fade) != ESP_OK) {
+            fade = 0;
+        }
+        printf("After %"PRId32" ms without frames: %s", timeout, loss_policy_names[policy]);
+        if (policy != LOSS_HOLD) {
+            printf(" over %"PRId32" ms", fade);
+        }
+        printf("\n");
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &loss_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, loss_arg.end, argv[0]);
+        return 1;
+    }
+
+    int policy = -1;
+    for (int i = 0; i < sizeof(loss_policy_names) / sizeof(loss_policy_names[0]); i++) {
+        if (strcmp(loss_arg.policy->sval[0], loss_policy_names[i]) == 0) {
+            policy = i;
+        }
+    }
+    if (policy < 0) {
+        printf("Policy must be hold, fade or scene\n");
+        return 1;
+    }
+
+    RETURN_ON_ERR(save_loss_timeout(loss_arg.timeout->ival[0]));
+    RETURN_ON_ERR(save_loss_policy(policy));
+    if (loss_arg.fade->count > 0) {
+        RETURN_ON_ERR(save_loss_fade(loss_arg.fade->ival[0]));
+    }
+    return 0;
+}
+
+static int scene_handler(int argc, char** argv)
+{
+    return render_store_loss_scene();
+}
+
+static int rmt_handler(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        int32_t dma, mem_symbols;
+        if (load_rmt_dma(&dma) != ESP_OK) {
+            dma = 0;
+        }
+        if (load_rmt_mem_symbols(&mem_symbols) != ESP_OK) {
+            mem_symbols = 0;
+        }
+        printf("RMT DMA: %s\n", dma ? "on" : "off");
+        if (mem_symbols <= 0) {
+            printf("memory block symbols: driver default\n");
+        } else {
+            printf("memory block symbols: %"PRId32"\n", mem_symbols);
+        }
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &rmt_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, rmt_arg.end, argv[0]);
+        return 1;
+    }
+
+    save_rmt_dma(rmt_arg.dma->ival[0] ? 1 : 0);
+    if (rmt_arg.mem_symbols->count) {
+        save_rmt_mem_symbols(rmt_arg.mem_symbols->ival[0]);
+    }
+
+    return 0;
+}
+
+static int bench_handler(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        bench_print_names();
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &bench_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, bench_arg.end, argv[0]);
+        return 1;
+    }
+
+    return bench_run(bench_arg.name->sval[0]);
+}
+
+static int palette_handler(int argc, char** argv)
+{
+    uint8_t palette[PIXEL_PALETTE_SIZE][3];
+    bool stored = load_palette(palette[0], sizeof(palette)) == ESP_OK;
+    if (argc == 1)
+    {
+        printf("%s palette\n", stored ? "Stored" : "Default");
+        return 0;
+    }
+
+    int err = arg_parse(argc, argv, (void**) &palette_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, palette_arg.end, argv[0]);
+        return 1;
+    }
+
+    int index = palette_arg.index->ival[0];
+    if (index < 0 || index >= PIXEL_PALETTE_SIZE) {
+        printf("Index must be 0-%d\n", PIXEL_PALETTE_SIZE - 1);
+        return 1;
+    }
+    if (!stored) {
+        pixel_default_palette(palette);
+    }
+    palette[index][0] = palette_arg.r->ival[0];
+    palette[index][1] = palette_arg.g->ival[0];
+    palette[index][2] = palette_arg.b->ival[0];
+    return save_palette(palette[0], sizeof(palette));
+}
+
+static int map_handler(int argc, char** argv)
+{
+    int err = arg_parse(argc, argv, (void**) &map_arg);
+    if (err)
+    {
+        arg_print_errors(stderr, map_arg.end, argv[0]);
+        return 1;
+    }
+
+    int index = 0;
+    if (map_arg.index->count > 0) {
+        index = map_arg.index->ival[0];
+    }
+    if (index < 0 || index >= MAX_LED_STRIPS) {
+        printf("Strip index must be 0-%d\n", MAX_LED_STRIPS - 1);
+        return 1;
+    }
+
+    char text[MAX_STRIP_MAP_LEN + 1] = "";
+    if (map_arg.tokens->count == 0) {
+        if (load_strip_map(index, text) != ESP_OK || !text[0]) {
+            printf("strip %d: default mapping\n", index);
+        } else {
+            printf("strip %d: %s\n", index, text);
+        }
+        return 0;
+    }
+
+    size_t len = 0;
+    for (int i = 0; i < map_arg.tokens->count; i++) {
+        const char *token = map_arg.tokens->sval[i];
+        if (len + strlen(token) + (i > 0) > MAX_STRIP_MAP_LEN) {
+            printf("Mapping is longer than %d characters\n", MAX_STRIP_MAP_LEN);
+            return 1;
+        }
+        len += sprintf(&text[len], "%s%s", i > 0 ? " " : "", token);
+    }
+    if (strcmp(text, "default") == 0) {
+        text[0] = '\0';
+    }
+    struct mapping mapping;
+    if (mapping_parse(text, &mapping) != ESP_OK) {
+        printf("Invalid mapping\n");
+        return 1;
+    }
+    // Check it against the strip too, if it is configured already
+    struct strip_settings settings;
+    if (load_strip_settings(index, &settings) == ESP_OK && settings.led_count > 0) {
+        struct pixel_map map;
+        int32_t group = settings.group > 0 ? settings.group : 1;
+        int err = mapping_compile(&mapping, settings.input, settings.led_count, group, &map);
+        if (err == ESP_ERR_INVALID_ARG) {
+            printf("Mapping does not fit the %s input of strip %d\n", pixel_input_name(settings.input), index);
+            return 1;
+        }
+        if (err == ESP_OK) {
+            mapping_free(&map);
+        }
+    }
+    return save_strip_map(index, text);
+}
+
 static int reboot(int argc, char** argv)
 {
     esp_restart();
@@ -251,31 +801,92 @@ void register_custom_cmds()
     };
     ESP_ERROR_CHECK(esp_console_cmd_register(&broker_cmd));
 
+    name_arg.name = arg_str1(NULL, NULL, "<name>", "Name of the device");
+    name_arg.end = arg_end(1);
+    const esp_console_cmd_t name_cmd = {
+        .command = "name",
+        .help = "Set the name the device announces in ArtPollReply, the first 17 "
+            "characters are the short name. Takes effect after a reboot",
+        .hint = NULL,
+        .func = &name_handler,
+        .argtable = &name_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&name_cmd));
+
     led_strip_arg.universe = arg_int1(NULL, NULL, "<universe>", "Artnet universe");
     led_strip_arg.channel = arg_int1(NULL, NULL, "<channel>", "First channel to use");
     led_strip_arg.led_count = arg_int1(NULL, NULL, "<led count>", "Number of leds in the strip");
     led_strip_arg.data_pin = arg_int1(NULL, NULL, "<data pin>", "Led strip data pin");
-    led_strip_arg.end = arg_end(4);
+    led_strip_arg.index = arg_int0("n", "index", "<n>", "Strip to configure, defaults to 0");
+    led_strip_arg.gamma = arg_int0("g", "gamma", "<tenths>", "Gamma correction in tenths, e.g. 22, 0 for none");
+    led_strip_arg.dither = arg_int0("d", "dither", "<0|1>", "Dither the gamma corrected output over refreshes");
+    led_strip_arg.input = arg_str0("m", "input", "<rgbi|palette|hsv>", "Slot layout of a pixel, 4, 1 or 3 channels");
+    led_strip_arg.group = arg_int0("G", "group", "<n>", "Leds driven by each pixel, defaults to 1");
+    led_strip_arg.model = arg_str0("M", "model", "<ws2812|apa102|sk9822>", "Led chip, apa102 and sk9822 are clocked over SPI");
+    led_strip_arg.clock_pin = arg_int0("C", "clock-pin", "<pin>", "Clock pin of a clocked strip");
+    led_strip_arg.clock_khz = arg_int0("k", "clock", "<kHz>", "Clock of a clocked strip, 1-40000, defaults to 10000");
+    led_strip_arg.end = arg_end(12);
 
     const esp_console_cmd_t led_strip_cmd = {
         .command = "strip",
-        .help = "Set the device to drive a ws2812 led strip",
+        .help = "Set the device to drive ws2812 led strips. Every strip has its own data pin "
+            "and they are refreshed in parallel. A led count of 0 disables a strip. "
+            "Clocked apa102 and sk9822 strips take a clock pin and an SPI bus each, "
+            "refreshing several times faster. "
+            "A long run can be split over two pins by continuing the channels of strip 0 on strip 1",
         .hint = NULL,
         .func = &led_strip_handler,
         .argtable = &led_strip_arg
     };
     ESP_ERROR_CHECK(esp_console_cmd_register(&led_strip_cmd));
 
+    palette_arg.index = arg_int1(NULL, NULL, "<index>", "Palette entry, 0-255");
+    palette_arg.r = arg_int1(NULL, NULL, "<r>", "Red");
+    palette_arg.g = arg_int1(NULL, NULL, "<g>", "Green");
+    palette_arg.b = arg_int1(NULL, NULL, "<b>", "Blue");
+    palette_arg.end = arg_end(4);
+    const esp_console_cmd_t palette_cmd = {
+        .command = "palette",
+        .help = "Set a color of the palette used by strips in palette input mode. "
+            "Unset entries come from the default palette, black and then a hue wheel. "
+            "Takes effect after a reboot",
+        .hint = NULL,
+        .func = &palette_handler,
+        .argtable = &palette_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&palette_cmd));
+
+    map_arg.index = arg_int0("n", "index", "<n>", "Strip to map, defaults to 0");
+    map_arg.tokens = arg_strn(NULL, NULL, "<token>", 0, 16, "in=<slots> out=<order> mirror reverse "
+            "width=<leds> serpentine segment=<leds>@<pixel>, or default");
+    map_arg.end = arg_end(17);
+    const esp_console_cmd_t map_cmd = {
+        .command = "map",
+        .help = "Set how the pixels of a strip land on its leds, e.g. map -n 1 in=rgbw out=grbw "
+            "width=16 serpentine. Without tokens prints the mapping. Takes effect after a reboot",
+        .hint = NULL,
+        .func = &map_handler,
+        .argtable = &map_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&map_cmd));
+
     led_rgb_arg.universe = arg_int1(NULL, NULL, "<universe>", "Artnet universe");
     led_rgb_arg.channel = arg_int1(NULL, NULL, "<channel>", "First channel to use");
     led_rgb_arg.r_pin = arg_int1(NULL, NULL, "<r pin>", "Data pin for red color channel, -1 to disable");
     led_rgb_arg.g_pin = arg_int1(NULL, NULL, "<g pin>", "Data pin for green color channel, -1 to disable");
     led_rgb_arg.b_pin = arg_int1(NULL, NULL, "<b pin>", "Data pin for blue color channel, -1 to disable");
-    led_rgb_arg.end = arg_end(5);
+    led_rgb_arg.freq = arg_int0("f", "freq", "<hz>", "PWM frequency, defaults to 3000. "
+            "The duty resolution is the highest the clock allows at it, up to 16 bits");
+    led_rgb_arg.wide = arg_int0("w", "wide", "<0|1>", "16 bit input, a coarse and a fine channel per color and intensity");
+    led_rgb_arg.gamma = arg_int0("g", "gamma", "<tenths>", "Gamma correction in tenths, e.g. 22, 0 for none");
+    led_rgb_arg.fade = arg_int0("F", "fade", "<0|1>", "Ramp to each frame with the LEDC fade hardware over "
+            "the interval between frames, or over the fade time in tenths of a second in the channel after the led");
+    led_rgb_arg.end = arg_end(9);
 
     const esp_console_cmd_t led_rgb_cmd = {
         .command = "rgb",
-        .help = "Set the device to drive a single rgb led with PWM",
+        .help = "Set the device to drive a single rgb led with PWM. With wide input the channels are "
+            "r, g, b and intensity as coarse/fine pairs",
         .hint = NULL,
         .func = &led_rgb_handler,
         .argtable = &led_rgb_arg
@@ -294,6 +905,81 @@ void register_custom_cmds()
     };
     ESP_ERROR_CHECK(esp_console_cmd_register(&button_cmd));
 
+    sync_arg.timeout = arg_int1(NULL, NULL, "<timeout ms>", "Fall back to immediate output after this long without ArtSync, 0 to ignore ArtSync");
+    sync_arg.end = arg_end(1);
+
+    const esp_console_cmd_t sync_cmd = {
+        .command = "sync",
+        .help = "Set the ArtSync timeout used for synchronous output",
+        .hint = NULL,
+        .func = &sync_handler,
+        .argtable = &sync_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&sync_cmd));
+
+    rate_arg.rate = arg_int1(NULL, NULL, "<hz>", "Render rate, 0 to render each frame as it arrives");
+    rate_arg.end = arg_end(1);
+
+    const esp_console_cmd_t rate_cmd = {
+        .command = "rate",
+        .help = "Render the leds at a fixed rate, crossfading from frame to frame over "
+            "the interval they arrive at. Smooths fades over a jittery link",
+        .hint = NULL,
+        .func = &rate_handler,
+        .argtable = &rate_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&rate_cmd));
+
+    keepalive_arg.ms = arg_int1(NULL, NULL, "<ms>", "Longest time between refreshes, 0 to send every frame");
+    keepalive_arg.end = arg_end(1);
+
+    const esp_console_cmd_t keepalive_cmd = {
+        .command = "keepalive",
+        .help = "Skip decoding and sending frames that are the same as the one on the leds, "
+            "refreshing them at least this often. Takes effect after a reboot",
+        .hint = NULL,
+        .func = &keepalive_handler,
+        .argtable = &keepalive_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&keepalive_cmd));
+
+    loss_arg.timeout = arg_int1(NULL, NULL, "<timeout ms>", "Time without frames before the stream counts as lost, 0 to disable");
+    loss_arg.policy = arg_str1(NULL, NULL, "<hold|fade|scene>", "Keep the last frame, fade to black or fade to the stored scene");
+    loss_arg.fade = arg_int0("f", "fade", "<ms>", "Fade time");
+    loss_arg.end = arg_end(3);
+
+    const esp_console_cmd_t loss_cmd = {
+        .command = "loss",
+        .help = "Set what the leds show when art-net frames stop arriving",
+        .hint = NULL,
+        .func = &loss_handler,
+        .argtable = &loss_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&loss_cmd));
+
+    const esp_console_cmd_t scene_cmd = {
+        .command = "scene",
+        .help = "Store what the leds show now as the stream loss scene",
+        .hint = NULL,
+        .func = &scene_handler,
+        .argtable = NULL
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&scene_cmd));
+
+    rmt_arg.dma = arg_int1(NULL, NULL, "<dma>", "1 to send with DMA, falls back to interrupts on channels without DMA");
+    rmt_arg.mem_symbols = arg_int0(NULL, NULL, "<symbols>", "RMT memory block size in symbols, with DMA the DMA buffer size, 0 for the driver default");
+    rmt_arg.end = arg_end(2);
+
+    const esp_console_cmd_t rmt_cmd = {
+        .command = "rmt",
+        .help = "Set how the led strips are fed to the RMT. Larger blocks or DMA help "
+            "long strips that glitch under heavy wifi load, check with bench rmt",
+        .hint = NULL,
+        .func = &rmt_handler,
+        .argtable = &rmt_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&rmt_cmd));
+
     const esp_console_cmd_t voltage_cmd = {
         .command = "voltage",
         .help = "Query current battery voltage",
@@ -303,6 +989,27 @@ void register_custom_cmds()
     };
     ESP_ERROR_CHECK(esp_console_cmd_register(&voltage_cmd));
 
+    const esp_console_cmd_t stats_cmd = {
+        .command = "stats",
+        .help = "Print artnet receive and led output statistics",
+        .hint = NULL,
+        .func = &stats_handler,
+        .argtable = NULL
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&stats_cmd));
+
+    bench_arg.name = arg_str1(NULL, NULL, "<name>", "Benchmark to run, leave out to list them");
+    bench_arg.end = arg_end(1);
+
+    const esp_console_cmd_t bench_cmd = {
+        .command = "bench",
+        .help = "Run an on device benchmark",
+        .hint = NULL,
+        .func = &bench_handler,
+        .argtable = &bench_arg
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&bench_cmd));
+
     const esp_console_cmd_t reboot_cmd = {
         .command = "reboot",
         .help = "Reboot the device, useful for applying new settings",
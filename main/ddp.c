@@ -0,0 +1,230 @@
+// DDP (Distributed Display Protocol) receiver, assumes a full UDP message is passed as one
+#include "ddp.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "render.h"
+#include "util.h"
+
+#define PORT 4048
+
+#define HEADER_LEN 10
+// With the timecode flag the header has four more bytes
+#define HEADER_TIMECODE_LEN 14
+#define MAX_PAYLOAD_LEN 1440
+#define MAX_PACKET_LEN (HEADER_TIMECODE_LEN + MAX_PAYLOAD_LEN)
+
+// Header byte 0
+#define FLAG_VERSION_MASK 0xc0
+#define FLAG_VERSION_1 0x40
+#define FLAG_TIMECODE 0x10
+#define FLAG_STORAGE 0x08
+#define FLAG_REPLY 0x04
+#define FLAG_QUERY 0x02
+#define FLAG_PUSH 0x01
+
+// Header byte 3
+#define ID_DISPLAY 1
+#define ID_ALL 255
+
+// Upper bound of packets handled before looking at the deadline again
+#define MAX_DRAIN_PACKETS 32
+
+// Data is output this long after it arrived even if no push came
+#define PUSH_DEADLINE_MS 100
+
+static const char *TAG = "DDP";
+
+static struct {
+    uint32_t received;      // data packets written to the frame
+    uint32_t pushes;        // frames latched by the push flag
+    uint32_t coalesced;     // frames replaced by a newer one before rendering
+    uint32_t incomplete;    // frames output at the deadline without a push
+} counters;
+
+// Packets dropped, counted instead of logged
+static struct {
+    uint32_t outside;       // data past the end of the frame
+    uint32_t other;         // queries, replies and other destinations
+    uint32_t invalid;       // unknown version or malformed
+} drops;
+
+static struct timing parse_timing;
+
+static bool frame_pending = false;
+static int64_t frame_pending_since;
+
+static void commit_frame(void)
+{
+    frame_pending = false;
+    render_commit();
+}
+
+static int64_t pending_deadline(void)
+{
+    if (!frame_pending) {
+        return 0;
+    }
+    return frame_pending_since + PUSH_DEADLINE_MS * 1000LL;
+}
+
+static void flush_pending(void)
+{
+    if (frame_pending && esp_timer_get_time() >= pending_deadline()) {
+        counters.incomplete++;
+        commit_frame();
+    }
+}
+
+static void handle_ddp(const uint8_t *buf, size_t len, int64_t rx_time_us)
+{
+    if (len < HEADER_LEN || (buf[0] & FLAG_VERSION_MASK) != FLAG_VERSION_1) {
+        drops.invalid++;
+        return;
+    }
+    uint8_t flags = buf[0];
+    if (flags & (FLAG_QUERY | FLAG_REPLY | FLAG_STORAGE)
+            || (buf[3] != ID_DISPLAY && buf[3] != ID_ALL)) {
+        drops.other++;
+        return;
+    }
+
+    size_t header_len = flags & FLAG_TIMECODE ? HEADER_TIMECODE_LEN : HEADER_LEN;
+    uint32_t offset = (uint32_t)buf[4] << 24 | buf[5] << 16 | buf[6] << 8 | buf[7];
+    uint16_t data_len = buf[8] << 8 | buf[9];
+    if (len < header_len + data_len) {
+        drops.invalid++;
+        return;
+    }
+
+    // A push may come without data, to latch what was sent before
+    if (data_len > 0) {
+        if (offset >= render_frame_len()) {
+            drops.outside++;
+        } else {
+            counters.received++;
+            bool coalesced = render_write_at(offset, &buf[header_len], data_len, rx_time_us);
+            if (!frame_pending) {
+                // Later packets of the frame hit universes the first one made dirty
+                if (coalesced) {
+                    counters.coalesced++;
+                }
+                frame_pending = true;
+                frame_pending_since = rx_time_us;
+            }
+        }
+    }
+
+    if (flags & FLAG_PUSH && frame_pending) {
+        counters.pushes++;
+        commit_frame();
+    }
+}
+
+static void ddp_worker(void *bogus)
+{
+    uint8_t rx_buffer[MAX_PACKET_LEN];
+    struct sockaddr_in dest_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    int listen_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (listen_sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    int err = bind(listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+    if (err != 0) {
+        ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
+        goto CLEAN_UP;
+    }
+    ESP_LOGI(TAG, "Socket bound, port %d", PORT);
+
+    while (1) {
+        int ready = socket_wait(listen_sock, pending_deadline());
+        if (ready < 0) {
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
+            break;
+        }
+        if (ready == 0) {
+            flush_pending();
+            continue;
+        }
+
+        int recv_len = recvfrom(listen_sock, rx_buffer, sizeof(rx_buffer), 0, NULL, NULL);
+        if (recv_len < 0) {
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            break;
+        }
+
+        // The push flag latches, draining only bounds the time spent here
+        for (int drained = 0; recv_len >= 0; drained++) {
+            int64_t rx_time = esp_timer_get_time();
+            handle_ddp(rx_buffer, recv_len, rx_time);
+            timing_add(&parse_timing, esp_timer_get_time() - rx_time);
+
+            if (drained == MAX_DRAIN_PACKETS) {
+                break;
+            }
+            recv_len = recvfrom(listen_sock, rx_buffer, sizeof(rx_buffer), MSG_DONTWAIT, NULL, NULL);
+        }
+
+        if (recv_len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            break;
+        }
+
+        flush_pending();
+    }
+
+CLEAN_UP:
+    close(listen_sock);
+    vTaskDelete(NULL);
+}
+
+#define STACK_SIZE 4000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+static TaskHandle_t task_handle = NULL;
+
+void ddp_print_stats(void)
+{
+    printf("ddp packets received: %"PRIu32", pushes: %"PRIu32", coalesced: %"PRIu32
+            ", incomplete: %"PRIu32"\n",
+            counters.received, counters.pushes, counters.coalesced, counters.incomplete);
+    printf("ddp dropped, outside frame: %"PRIu32", other: %"PRIu32", invalid: %"PRIu32"\n",
+            drops.outside, drops.other, drops.invalid);
+    timing_print("ddp parse", &parse_timing);
+}
+
+void ddp_task_start(void)
+{
+    task_handle = xTaskCreateStatic(
+            ddp_worker,
+            "ddp",
+            STACK_SIZE,
+            (void*) 0,
+            // Same as art-net, above the render task
+            5,
+            xStack,
+            &xTaskBuffer
+            );
+}
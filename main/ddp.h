@@ -0,0 +1,14 @@
+#ifndef _DDP_H
+#define _DDP_H
+
+/*
+ * DDP receiver. Data offsets address the slots of the same frame the
+ * art-net universes are written to, starting from the first slot of
+ * the first universe, so the strips are mapped the same way. A packet
+ * with the push flag latches the frame.
+ */
+void ddp_task_start(void);
+
+void ddp_print_stats(void);
+
+#endif
@@ -0,0 +1,274 @@
+#include "mapping.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include "common.h"
+
+static const char *TAG = "MAPPING";
+
+static const struct mapping default_mapping = {
+    .in = {
+        .size = 4,
+        .red = 0,
+        .green = 1,
+        .blue = 2,
+        .white = -1,
+        .intensity = 3,
+    },
+    .out = "grb",
+};
+
+// Offset of a color letter in the layout
+static int8_t *layout_slot(struct pixel_layout *layout, char c)
+{
+    switch (c) {
+    case 'r': return &layout->red;
+    case 'g': return &layout->green;
+    case 'b': return &layout->blue;
+    case 'w': return &layout->white;
+    case 'i': return &layout->intensity;
+    default: return NULL;
+    }
+}
+
+static int parse_in(const char *value, size_t len, struct pixel_layout *layout)
+{
+    struct pixel_layout in = {
+        .size = len,
+        .red = -1,
+        .green = -1,
+        .blue = -1,
+        .white = -1,
+        .intensity = -1,
+    };
+    for (size_t i = 0; i < len; i++) {
+        int8_t *slot = layout_slot(&in, value[i]);
+        if (!slot || *slot >= 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        *slot = i;
+    }
+    if (in.red < 0 || in.green < 0 || in.blue < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *layout = in;
+    return ESP_OK;
+}
+
+static int parse_out(const char *value, size_t len, char out[5])
+{
+    if (len != 3 && len != 4) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Each of rgb, and w with four letters, exactly once
+    const char *colors = len == 4 ? "rgbw" : "rgb";
+    for (size_t i = 0; i < len; i++) {
+        if (!strchr(colors, value[i]) || memchr(value, value[i], i)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    memcpy(out, value, len);
+    out[len] = '\0';
+    return ESP_OK;
+}
+
+static int parse_number(const char *value, size_t len, uint16_t *number)
+{
+    uint32_t n = 0;
+    if (len == 0 || len > 5) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (value[i] < '0' || value[i] > '9') {
+            return ESP_ERR_INVALID_ARG;
+        }
+        n = n * 10 + value[i] - '0';
+    }
+    if (n > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *number = n;
+    return ESP_OK;
+}
+
+static int parse_segment(const char *value, size_t len, struct mapping *mapping)
+{
+    const char *at = memchr(value, '@', len);
+    if (!at || mapping->segment_count == MAPPING_MAX_SEGMENTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct mapping_segment *segment = &mapping->segments[mapping->segment_count];
+    RETURN_ON_ERR(parse_number(value, at - value, &segment->leds));
+    RETURN_ON_ERR(parse_number(at + 1, len - (at + 1 - value), &segment->pixel));
+    if (segment->leds == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mapping->segment_count++;
+    return ESP_OK;
+}
+
+static bool is_key(const char *token, size_t len, const char *key)
+{
+    size_t key_len = strlen(key);
+    return len >= key_len && strncmp(token, key, key_len) == 0;
+}
+
+static int parse_token(const char *token, size_t len, struct mapping *mapping)
+{
+    if (len == 7 && strncmp(token, "reverse", len) == 0) {
+        mapping->reverse = true;
+    } else if (len == 6 && strncmp(token, "mirror", len) == 0) {
+        mapping->mirror = true;
+    } else if (len == 10 && strncmp(token, "serpentine", len) == 0) {
+        mapping->serpentine = true;
+    } else if (is_key(token, len, "in=")) {
+        return parse_in(token + 3, len - 3, &mapping->in);
+    } else if (is_key(token, len, "out=")) {
+        return parse_out(token + 4, len - 4, mapping->out);
+    } else if (is_key(token, len, "width=")) {
+        RETURN_ON_ERR(parse_number(token + 6, len - 6, &mapping->width));
+        return mapping->width > 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+    } else if (is_key(token, len, "segment=")) {
+        return parse_segment(token + 8, len - 8, mapping);
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+int mapping_parse(const char *text, struct mapping *mapping)
+{
+    *mapping = default_mapping;
+
+    const char *token = text;
+    while (*token) {
+        if (*token == ' ') {
+            token++;
+            continue;
+        }
+        size_t len = strcspn(token, " ");
+        if (parse_token(token, len, mapping)) {
+            ESP_LOGW(TAG, "Invalid mapping token '%.*s'", (int) len, token);
+            return ESP_ERR_INVALID_ARG;
+        }
+        token += len;
+    }
+
+    if (mapping->serpentine && mapping->width == 0) {
+        ESP_LOGW(TAG, "A serpentine mapping needs the width of its rows");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static bool is_identity(const struct mapping *mapping, uint32_t group)
+{
+    return !mapping->mirror && !mapping->reverse && !mapping->serpentine
+        && mapping->segment_count == 0 && group == 1;
+}
+
+// Input pixel shown by led i of count
+static uint32_t map_led(const struct mapping *mapping, uint32_t count, uint32_t group, uint32_t i)
+{
+    uint32_t p = i;
+    if (mapping->mirror) {
+        if (p >= (count + 1) / 2) {
+            p = count - 1 - p;
+        }
+        count = (count + 1) / 2;
+    }
+    if (mapping->reverse) {
+        p = count - 1 - p;
+    }
+    if (mapping->serpentine) {
+        uint32_t row = p / mapping->width;
+        if (row & 1) {
+            p = row * mapping->width + mapping->width - 1 - p % mapping->width;
+        }
+    }
+    if (mapping->segment_count) {
+        uint32_t first = 0;
+        int s = 0;
+        for (; s < mapping->segment_count; s++) {
+            if (p < first + mapping->segments[s].leds) {
+                break;
+            }
+            first += mapping->segments[s].leds;
+        }
+        if (s == mapping->segment_count) {
+            return PIXEL_DARK;
+        }
+        p = mapping->segments[s].pixel + p - first;
+    }
+    return p / group;
+}
+
+int mapping_compile(const struct mapping *mapping, enum pixel_input input,
+        uint32_t count, uint32_t group, struct pixel_map *map)
+{
+    map->input = input;
+    map->layout = input == PIXEL_INPUT_RGBI ? mapping->in : pixel_layout_rgbi;
+    map->index = NULL;
+    // A missing white slot is sent as zero, but only the fourth byte can be left out
+    if (memchr(mapping->out, 'w', 3) && map->layout.white < 0) {
+        ESP_LOGW(TAG, "Output order %s puts white first, the input has none", mapping->out);
+        return ESP_ERR_INVALID_ARG;
+    }
+    map->pixels = (count + group - 1) / group;
+    if (is_identity(mapping, group)) {
+        return ESP_OK;
+    }
+
+    map->index = calloc(count, sizeof(*map->index));
+    if (!map->index) {
+        return ESP_ERR_NO_MEM;
+    }
+    map->pixels = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t p = map_led(mapping, count, group, i);
+        if (p == PIXEL_DARK) {
+            map->index[i] = PIXEL_DARK;
+            continue;
+        }
+        if (p >= PIXEL_DARK) {
+            ESP_LOGW(TAG, "Led %"PRIu32" maps to pixel %"PRIu32", past the last one", i, p);
+            mapping_free(map);
+            return ESP_ERR_INVALID_ARG;
+        }
+        map->index[i] = p;
+        if (p >= map->pixels) {
+            map->pixels = p + 1;
+        }
+    }
+    return ESP_OK;
+}
+
+void mapping_free(struct pixel_map *map)
+{
+    free(map->index);
+    map->index = NULL;
+}
+
+unsigned int mapping_out_size(const struct mapping *mapping)
+{
+    return strlen(mapping->out);
+}
+
+void mapping_transform(const struct mapping *mapping, const struct pixel_layout *layout,
+        led_strip_transform_t *transform)
+{
+    struct pixel_layout colors = *layout;
+    // The transform names the wire slots of GRB(W) leds
+    uint8_t *wire[3] = {&transform->green, &transform->red, &transform->blue};
+    for (int i = 0; i < 3; i++) {
+        *wire[i] = *layout_slot(&colors, mapping->out[i]);
+    }
+    transform->white = mapping->out[3] ? *layout_slot(&colors, mapping->out[3]) : -1;
+    transform->intensity = layout->intensity;
+    transform->stride = layout->size;
+}
@@ -0,0 +1,77 @@
+#ifndef _MAPPING_H
+#define _MAPPING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "led_strip.h"
+#include "pixel.h"
+
+/*
+ * How a strip is wired up, stored per strip as a short description
+ * such as "in=rgbw out=grbw width=16 serpentine". It is compiled into
+ * an index table when the strips are set up, so rearranging a fixture
+ * needs no firmware changes and costs a table lookup per led.
+ *
+ * Space separated tokens, all optional:
+ *   in=<slots>     slots of an rgbi input pixel, from r, g, b, w and i,
+ *                  rgbi by default. r, g and b are required
+ *   out=<order>    color order on the wire, grb by default. Four letters
+ *                  drive rgbw leds
+ *   mirror         the second half of the strip mirrors the first
+ *   reverse        the strip starts from its far end
+ *   width=<leds>   leds per row of a matrix
+ *   serpentine     every other row of the matrix runs backwards
+ *   segment=<leds>@<pixel>
+ *                  the next leds show pixels from <pixel> on, up to 8
+ *                  of them. Leds past the last segment stay dark
+ *
+ * The led positions go through these steps in this order, and are
+ * divided by the pixel grouping of the strip last.
+ */
+
+#define MAPPING_MAX_SEGMENTS 8
+
+struct mapping_segment {
+    uint16_t leds;
+    uint16_t pixel;
+};
+
+struct mapping {
+    struct pixel_layout in;
+    // Wire order, three or four of r, g, b and w
+    char out[5];
+    bool mirror;
+    bool reverse;
+    bool serpentine;
+    uint16_t width;
+    uint8_t segment_count;
+    struct mapping_segment segments[MAPPING_MAX_SEGMENTS];
+};
+
+// Parse a description, an empty one is the default mapping
+int mapping_parse(const char *text, struct mapping *mapping);
+
+/*
+ * Build the pixel map of a strip of count leds. The index table is
+ * allocated unless every led shows the pixel at its own position,
+ * free it with mapping_free(). ESP_ERR_INVALID_ARG if the mapping
+ * does not fit the input, e.g. it sends white before the colors and
+ * the input has no white slot.
+ */
+int mapping_compile(const struct mapping *mapping, enum pixel_input input,
+        uint32_t count, uint32_t group, struct pixel_map *map);
+void mapping_free(struct pixel_map *map);
+
+// Bytes per led on the wire
+unsigned int mapping_out_size(const struct mapping *mapping);
+
+/*
+ * Point the color offsets of the transform at the leds laid out as
+ * layout, in the wire order of the mapping. The gamma and dither
+ * fields are left as they are.
+ */
+void mapping_transform(const struct mapping *mapping, const struct pixel_layout *layout,
+        led_strip_transform_t *transform);
+
+#endif
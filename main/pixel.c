@@ -0,0 +1,135 @@
+#include "pixel.h"
+
+#include <string.h>
+
+static const char *input_names[PIXEL_INPUT_COUNT] = {
+    [PIXEL_INPUT_RGBI] = "rgbi",
+    [PIXEL_INPUT_PALETTE] = "palette",
+    [PIXEL_INPUT_HSV] = "hsv",
+};
+
+const struct pixel_layout pixel_layout_rgbi = {
+    .size = 4,
+    .red = 0,
+    .green = 1,
+    .blue = 2,
+    .white = -1,
+    .intensity = 3,
+};
+
+unsigned int pixel_map_channels(const struct pixel_map *map)
+{
+    switch (map->input) {
+    case PIXEL_INPUT_PALETTE:
+        return 1;
+    case PIXEL_INPUT_HSV:
+        return 3;
+    default:
+        return map->layout.size;
+    }
+}
+
+const char *pixel_input_name(enum pixel_input input)
+{
+    return input < PIXEL_INPUT_COUNT ? input_names[input] : "unknown";
+}
+
+// x / 255 rounded, for x up to 255 * 255
+static inline uint8_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+void pixel_hsv_to_rgb(uint8_t h, uint8_t s, uint8_t v, uint8_t rgb[3])
+{
+    if (s == 0) {
+        rgb[0] = rgb[1] = rgb[2] = v;
+        return;
+    }
+    // Six sectors of 256 steps each
+    uint32_t h6 = h * 6;
+    uint8_t sector = h6 >> 8;
+    uint8_t frac = h6 & 0xff;
+    uint8_t p = div255(v * (255 - s));
+    uint8_t q = div255(v * (255 - div255(s * frac)));
+    uint8_t t = div255(v * (255 - div255(s * (255 - frac))));
+
+    switch (sector) {
+    case 0: rgb[0] = v; rgb[1] = t; rgb[2] = p; break;
+    case 1: rgb[0] = q; rgb[1] = v; rgb[2] = p; break;
+    case 2: rgb[0] = p; rgb[1] = v; rgb[2] = t; break;
+    case 3: rgb[0] = p; rgb[1] = q; rgb[2] = v; break;
+    case 4: rgb[0] = t; rgb[1] = p; rgb[2] = v; break;
+    default: rgb[0] = v; rgb[1] = p; rgb[2] = q; break;
+    }
+}
+
+void pixel_default_palette(uint8_t palette[PIXEL_PALETTE_SIZE][3])
+{
+    memset(palette[0], 0, 3);
+    for (int i = 1; i < PIXEL_PALETTE_SIZE; i++) {
+        pixel_hsv_to_rgb(i - 1, 255, 255, palette[i]);
+    }
+}
+
+struct pixel_layout pixel_decoded_layout(const struct pixel_map *map)
+{
+    struct pixel_layout layout = pixel_layout_rgbi;
+    if (map->input == PIXEL_INPUT_RGBI && map->layout.white >= 0) {
+        layout.size = 5;
+        layout.white = 3;
+        layout.intensity = 4;
+    }
+    return layout;
+}
+
+static inline uint8_t slot(const uint8_t *src, int8_t offset, uint8_t missing)
+{
+    return offset >= 0 ? src[offset] : missing;
+}
+
+void pixel_decode(const struct pixel_map *map, const uint8_t palette[PIXEL_PALETTE_SIZE][3],
+        const uint8_t *src, uint8_t *dst, uint32_t count)
+{
+    const struct pixel_layout *in = &map->layout;
+    struct pixel_layout out = pixel_decoded_layout(map);
+    unsigned int channels = pixel_map_channels(map);
+    uint32_t previous = PIXEL_DARK;
+
+    for (uint32_t i = 0; i < count; i++, dst += out.size) {
+        uint32_t p = map->index ? map->index[i] : i;
+        if (p == PIXEL_DARK) {
+            memset(dst, 0, out.size);
+            previous = PIXEL_DARK;
+            continue;
+        }
+        if (p == previous) {
+            // Grouped leds, same as the one before
+            memcpy(dst, dst - out.size, out.size);
+            continue;
+        }
+        previous = p;
+
+        const uint8_t *pixel = &src[p * channels];
+        switch (map->input) {
+        case PIXEL_INPUT_PALETTE:
+            memcpy(dst, palette[*pixel], 3);
+            dst[3] = 255;
+            break;
+        case PIXEL_INPUT_HSV:
+            pixel_hsv_to_rgb(pixel[0], pixel[1], pixel[2], dst);
+            dst[3] = 255;
+            break;
+        default:
+            dst[0] = slot(pixel, in->red, 0);
+            dst[1] = slot(pixel, in->green, 0);
+            dst[2] = slot(pixel, in->blue, 0);
+            if (out.white >= 0) {
+                dst[out.white] = slot(pixel, in->white, 0);
+            }
+            dst[out.intensity] = slot(pixel, in->intensity, 255);
+            break;
+        }
+    }
+}
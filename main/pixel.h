@@ -0,0 +1,65 @@
+#ifndef _PIXEL_H
+#define _PIXEL_H
+
+#include <stdint.h>
+
+/*
+ * Slot layouts a strip can take its pixels in. Unless every strip reads
+ * plain color slots one pixel per led, everything is decoded to color
+ * and intensity slots before it is faded and sent to the leds.
+ */
+enum pixel_input {
+    PIXEL_INPUT_RGBI = 0,   // color slots laid out as in the mapping, rgbi by default
+    PIXEL_INPUT_PALETTE,    // one slot indexing the palette
+    PIXEL_INPUT_HSV,        // hue, saturation and value
+    PIXEL_INPUT_COUNT
+};
+
+#define PIXEL_PALETTE_SIZE 256
+// An index entry for a led not driven by any pixel
+#define PIXEL_DARK 0xffff
+
+// Offsets of the colors in a pixel, -1 if it does not have one
+struct pixel_layout {
+    uint8_t size;
+    int8_t red;
+    int8_t green;
+    int8_t blue;
+    int8_t white;
+    int8_t intensity;
+};
+
+extern const struct pixel_layout pixel_layout_rgbi;
+
+// How the input pixels of a strip become leds, built by mapping_compile()
+struct pixel_map {
+    enum pixel_input input;
+    // Slots of a PIXEL_INPUT_RGBI pixel
+    struct pixel_layout layout;
+    // Input pixel of each led, NULL when led n shows pixel n
+    uint16_t *index;
+    // Input pixels the leds read
+    uint32_t pixels;
+};
+
+// Slots per input pixel
+unsigned int pixel_map_channels(const struct pixel_map *map);
+const char *pixel_input_name(enum pixel_input input);
+
+/*
+ * Layout of the leds pixel_decode() writes: red, green, blue, white
+ * if the input has it, and intensity.
+ */
+struct pixel_layout pixel_decoded_layout(const struct pixel_map *map);
+
+// Hue wraps around over 0-255, 8 bit fixed point
+void pixel_hsv_to_rgb(uint8_t h, uint8_t s, uint8_t v, uint8_t rgb[3]);
+
+// Black at 0, then the hues at full saturation
+void pixel_default_palette(uint8_t palette[PIXEL_PALETTE_SIZE][3]);
+
+// Decode count leds from the input pixels at src
+void pixel_decode(const struct pixel_map *map, const uint8_t palette[PIXEL_PALETTE_SIZE][3],
+        const uint8_t *src, uint8_t *dst, uint32_t count);
+
+#endif
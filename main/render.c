@@ -0,0 +1,1741 @@
+#include "render.h"
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "common.h"
+#include "config.h"
+#include "driver/ledc.h"
+#include "led_strip.h"
+#include "mapping.h"
+#include "pixel.h"
+#include "util.h"
+
+static const char *TAG = "RENDER";
+
+enum led_type led_type;
+
+static int32_t artnet_universe;
+int32_t artnet_first_channel;
+
+/* LED strip initialization with the GPIO and pixels number*/
+static const led_strip_config_t strip_config_template = {
+    .strip_gpio_num = -1, // The GPIO that connected to the LED strip's data line
+    .max_leds = -1, // The number of LEDs in the strip,
+    .led_pixel_format = LED_PIXEL_FORMAT_GRB, // Pixel format of your LED strip
+    .led_model = LED_MODEL_WS2812, // LED strip model
+    .flags.invert_out = false, // whether to invert the output signal (useful when your hardware has a level inverter)
+};
+
+static bool strip_refresh_done(led_strip_handle_t strip, void *user_ctx);
+
+static const led_strip_rmt_config_t rmt_config_template = {
+    .clk_src = RMT_CLK_SRC_DEFAULT, // different clock source can lead to different power consumption
+    .resolution_hz = 10 * 1000 * 1000, // 10MHz
+    .on_refresh_done = strip_refresh_done,
+    .flags.with_dma = false, // overridden by NVS_KEY_RMT_DMA
+    .flags.async_refresh = true, // return from refresh as soon as the frame is queued
+};
+
+static const led_strip_apa102_config_t apa102_config_template = {
+    .clk_src = SPI_CLK_SRC_DEFAULT,
+    .on_refresh_done = strip_refresh_done,
+    .flags.with_dma = true, // a frame is far longer than the SPI buffer
+    .flags.async_refresh = true,
+};
+
+// The layout of the single led driven by the LEDC
+struct led_rgbi {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t i;
+};
+// With wide input every slot of it is a coarse/fine pair
+#define LEDC_WIDE_SLOTS (2 * sizeof(struct led_rgbi))
+
+static bool ledc_wide;
+// Duty of a fully lit channel
+static uint32_t ledc_max_duty;
+// 8 bit level to 16 bits, interpolated for wide input. NULL for linear
+static uint16_t *ledc_gamma;
+
+/*
+ * With hardware fading the LEDC ramps to every new frame by itself over
+ * ledc_fade_time, the measured interval between frames unless the fade
+ * slot after the led gives one in tenths of a second. Loss fades are
+ * done the same way. Fixed rate rendering is not used then.
+ */
+static bool ledc_fade;
+static int64_t ledc_fade_time;
+// Duty last set per channel, unchanged channels are not touched
+static uint32_t ledc_duty_set[3];
+
+// Slots the single led takes from the frame
+static size_t ledc_slots(void)
+{
+    return (ledc_wide ? LEDC_WIDE_SLOTS : sizeof(struct led_rgbi)) + (ledc_fade ? 1 : 0);
+}
+
+/*
+ * Every strip is on its own RMT channel, or SPI bus if it is clocked.
+ * All strips are refreshed back to back without waiting, so they are
+ * clocked out in parallel and a frame takes as long as the longest strip.
+ */
+struct strip {
+    led_strip_handle_t handle;
+    struct strip_settings settings;
+    // Offset of the first channel of the strip in back_buf
+    size_t frame_offset;
+    // Offset of the decoded leds of the strip in the front buffers
+    size_t pixel_offset;
+    // Wiring of the strip and the input pixels it compiles to
+    struct mapping mapping;
+    struct pixel_map map;
+    // Layout of the leds in the front buffers
+    struct pixel_layout layout;
+    // Leds fed from the frame, less than configured if the frame is too short
+    uint32_t count;
+    // The last refresh was started, its done callback is waited for
+    bool sent;
+    volatile int64_t refresh_done_time;
+    // Time the frame takes on the wire when the RMT is fed in time
+    int64_t expected_us;
+    // Front buffer leds to the wire order, with the gamma table and dither state of the strip
+    led_strip_transform_t transform;
+};
+
+/*
+ * Dithering spreads the 16 bit gamma corrected levels over refreshes,
+ * so the last frame is sent again this often while no new one arrives.
+ */
+#define DITHER_PERIOD_MS 10
+static bool dithering;
+
+// Render task notification bits
+#define NOTIFY_FRAME (1u << 0)  // render_commit(), a new frame is in back_buf
+#define NOTIFY_TICK  (1u << 1)  // fixed rate render timer
+#define NOTIFY_WIRE  (1u << 2)  // a strip has sent its frame out
+
+/*
+ * Fixed rate rendering. Each new frame is latched into fade_to and
+ * what was on the leds at that moment into fade_from. On every tick
+ * the output is blended from one to the other, taking the measured
+ * interval between frames to get there, and held once there.
+ */
+// Fades never take longer than this, however seldom frames arrive
+#define MAX_FADE_US (1000 * 1000)
+static int32_t render_rate;
+static esp_timer_handle_t tick_timer;
+static uint8_t *fade_from;
+static uint8_t *fade_to;
+static int64_t fade_start;
+static int64_t fade_duration;
+// Smoothed interval between received frames
+static int64_t frame_interval;
+// Receive time of fade_to until its first tick is out
+static int64_t fade_rx_time;
+static bool fade_done = true;
+// Something has been sent to the leds, front_bufs[front ^ 1] is on them
+static bool shown;
+
+/*
+ * Stream loss watchdog. When no frame has arrived for loss_timeout
+ * the leds are faded locally to black or to the stored scene over
+ * loss_fade, using the same fade as fixed rate rendering, or held.
+ */
+// Fade step when not rendering at a fixed rate
+#define LOSS_FADE_STEP_MS 20
+static int64_t loss_timeout;
+static int64_t loss_fade;
+static enum loss_policy loss_policy;
+// Black or the stored scene
+static uint8_t *loss_target;
+static int64_t last_frame_time;
+static bool lost;
+
+/*
+ * ws2812 timing at the 10MHz RMT resolution, used for estimating how
+ * long a frame should take on the wire.
+ */
+#define WS2812_BIT_NS 1250
+#define WS2812_RESET_US 50
+// led_strip picks this many symbols when mem_block_symbols is 0
+#define RMT_DEFAULT_MEM_SYMBOLS 48
+
+// Clocked strips take an SPI bus each, starting from SPI2 as SPI1 is the flash
+static int spi_hosts_used;
+
+static int32_t rmt_dma;
+static int32_t rmt_mem_symbols;
+/*
+ * Without DMA the RMT interrupt refills half of the channel memory
+ * while the other half is sent out. If the refill is later than the
+ * time it takes to send the whole memory block, stale symbols went
+ * out and the strip glitched. A frame finishing this much later than
+ * expected is counted as late.
+ */
+static int64_t late_margin_us;
+
+static struct strip strips[MAX_LED_STRIPS];
+static int strip_count;
+
+/*
+ * The receiver writes to back_buf, the render task copies it to a
+ * front buffer under frame_lock and works on the copy. Copying instead
+ * of swapping keeps slots that were not part of the latest update intact.
+ *
+ * The strips encode straight from the front buffer while the frame is
+ * on the wire, so the render task alternates between two of them.
+ * A front buffer is reused only after its frame has been sent out.
+ *
+ * Strips longer than one universe span consecutive universes. The
+ * frame covers the universes from the lowest one used by a strip to
+ * the highest, laid out back to back in back_buf.
+ *
+ * If every strip takes RGBI slots one per led, the front buffers are a
+ * plain copy of the frame. Otherwise the strips are decoded to RGBI
+ * while latching and placed back to back in the front buffers, so fades
+ * and the loss scene always work on colors. The fade buffers and the
+ * loss scene are laid out like the front buffers.
+ */
+static uint8_t *back_buf;
+static uint8_t *front_bufs[2];
+static int front;
+static size_t frame_len;
+static size_t output_len;
+static bool decoding;
+// Colors of the palette input mode, NULL if no strip uses it
+static uint8_t (*palette)[3];
+static unsigned int universe_count = 1;
+// Universes of the frame some strip reads from
+static uint32_t universe_mask = 1;
+// Universes written to back_buf since the render task last latched it
+static uint32_t back_dirty;
+// Receive time of the oldest data in back_buf not rendered yet
+static int64_t back_rx_time;
+
+/*
+ * Consoles keep sending the same look over and over. Writes that do not
+ * change back_buf do not make it dirty, so unchanged frames are neither
+ * decoded nor sent, but the leds are still refreshed every keepalive.
+ */
+#define DEFAULT_KEEPALIVE_MS 1000
+// 0 to send every frame
+static int64_t keepalive;
+// A frame arrived since the last latch, changed or not
+static bool back_received;
+// back_buf has been latched, so writes can be compared against it
+static bool back_latched;
+// When the leds were last refreshed with a frame
+static int64_t last_output_time;
+static SemaphoreHandle_t frame_lock;
+static StaticSemaphore_t frame_lock_buffer;
+// Held while the strips are driven, the benchmark borrows them with it
+static SemaphoreHandle_t output_lock;
+static StaticSemaphore_t output_lock_buffer;
+
+#define STACK_SIZE 4000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+static TaskHandle_t task_handle = NULL;
+
+static struct {
+    uint32_t rendered;
+    uint32_t redrawn;       // frames sent again for dithering
+    uint32_t unchanged;     // frames skipped, the same as on the leds
+    uint32_t keepalives;    // unchanged frames sent anyway, keepalive passed
+    uint32_t ticks;         // fixed rate frames sent
+    uint32_t losses;        // times the stream was lost
+    uint32_t late;          // frames that took longer than expected on the wire
+    uint32_t deferred;      // commits and ticks held back until the strips were done sending
+    uint32_t missed;        // frames sent later than one wire period after they arrived
+    uint32_t failed;        // strip refreshes the led driver refused
+    uint32_t ledc_fades;    // LEDC channels ramped in hardware
+    struct timing latch;    // receive -> latched by the render task
+    struct timing decode;   // input pixels -> RGBI while latching
+    struct timing convert;  // slot data -> led driver, strips convert while refreshing
+    struct timing refresh;  // time blocked in the led driver
+    struct timing wire;     // strip refresh started -> sent out
+    struct timing total;    // receive -> output done
+} stats;
+
+/*
+ * The strip refresh returns before the frame is sent out, the frame
+ * on the wire is accounted once the refresh done callbacks of all
+ * strips have run.
+ */
+static int64_t inflight_start;
+static int64_t inflight_rx_time;
+
+/*
+ * A frame is started only once the previous one is off the wire, and
+ * it is latched right then, so it is the freshest one and frames never
+ * queue up behind a long strip. The strips pace the output to at most
+ * one frame per wire_period, the time the longest of them takes.
+ */
+static int64_t wire_period;
+
+// Runs in the driver interrupt, which for SPI keeps running while the flash cache is off
+static bool IRAM_ATTR strip_refresh_done(led_strip_handle_t handle, void *user_ctx)
+{
+    struct strip *strip = user_ctx;
+    BaseType_t woken = pdFALSE;
+    strip->refresh_done_time = esp_timer_get_time();
+    if (task_handle) {
+        xTaskNotifyFromISR(task_handle, NOTIFY_WIRE, eSetBits, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+/*
+ * Returns the time the last strip finished sending the frame started
+ * at start, 0 if some strip is still on the wire. late is set if some
+ * strip took notably longer than it should have.
+ */
+static int64_t frame_done_time(int64_t start, bool *late)
+{
+    // Nothing to wait for if no strip gets data
+    int64_t done = start;
+    *late = false;
+    for (int i = 0; i < strip_count; i++) {
+        if (!strips[i].sent) {
+            // Not refreshed at all
+            continue;
+        }
+        int64_t strip_done = strips[i].refresh_done_time;
+        if (strip_done < start) {
+            return 0;
+        }
+        if (strip_done - start > strips[i].expected_us + late_margin_us) {
+            *late = true;
+        }
+        if (strip_done > done) {
+            done = strip_done;
+        }
+    }
+    return done;
+}
+
+static void account_refresh_done(void)
+{
+    bool late;
+    if (!inflight_start) {
+        return;
+    }
+    int64_t done = frame_done_time(inflight_start, &late);
+    if (!done) {
+        // Still on the wire
+        return;
+    }
+    if (late) {
+        stats.late++;
+    }
+    timing_add(&stats.wire, done - inflight_start);
+    if (inflight_rx_time) {
+        timing_add(&stats.total, done - inflight_rx_time);
+    }
+    inflight_start = 0;
+}
+
+// 8 bit level to 16 bits, level^gamma
+static uint16_t *build_gamma(int32_t gamma_tenths)
+{
+    uint16_t *table = malloc(256 * sizeof(uint16_t));
+    if (!table) {
+        return NULL;
+    }
+    float gamma = gamma_tenths / 10.0f;
+    for (int i = 0; i < 256; i++) {
+        table[i] = lroundf(powf(i / 255.0f, gamma) * 65535.0f);
+    }
+    return table;
+}
+
+static bool strip_clocked(const struct strip *strip)
+{
+    return strip->settings.model == STRIP_APA102 || strip->settings.model == STRIP_SK9822;
+}
+
+static int init_strip_transform(int index, struct strip *strip)
+{
+    struct strip_settings *settings = &strip->settings;
+    // The color offsets are filled in once the strips are placed
+    strip->transform = (led_strip_transform_t) {0};
+    if (settings->gamma <= 0) {
+        return 0;
+    }
+    // Clocked strips get the extra resolution from the global brightness of each led instead
+    if (strip_clocked(strip)) {
+        settings->dither = 0;
+    }
+    strip->transform.gamma16 = build_gamma(settings->gamma);
+    if (settings->dither) {
+        strip->transform.dither = calloc(settings->led_count, mapping_out_size(&strip->mapping));
+    }
+    if (!strip->transform.gamma16 || (settings->dither && !strip->transform.dither)) {
+        ESP_LOGE(TAG, "No memory for the gamma table of strip %d", index);
+        free((void*) strip->transform.gamma16);
+        free(strip->transform.dither);
+        strip->transform.gamma16 = NULL;
+        strip->transform.dither = NULL;
+        return -1;
+    }
+    ESP_LOGI(TAG, "Strip %d gamma %"PRId32".%"PRId32"%s", index, settings->gamma / 10,
+            settings->gamma % 10, settings->dither ? ", dithered" : "");
+    dithering |= settings->dither != 0;
+    return 0;
+}
+
+static int init_strip_mapping(int index, struct strip *strip)
+{
+    struct strip_settings *settings = &strip->settings;
+    char text[MAX_STRIP_MAP_LEN + 1];
+    if (load_strip_map(index, text) != ESP_OK) {
+        text[0] = '\0';
+    }
+    if (mapping_parse(text, &strip->mapping)) {
+        ESP_LOGW(TAG, "Strip %d has an invalid mapping, using the default one", index);
+        mapping_parse("", &strip->mapping);
+    }
+    int err = mapping_compile(&strip->mapping, settings->input, settings->led_count, settings->group, &strip->map);
+    if (err == ESP_ERR_INVALID_ARG) {
+        ESP_LOGW(TAG, "Strip %d mapping does not fit, using the default one", index);
+        mapping_parse("", &strip->mapping);
+        err = mapping_compile(&strip->mapping, settings->input, settings->led_count, settings->group, &strip->map);
+    }
+    if (err) {
+        ESP_LOGE(TAG, "No memory for the mapping of strip %d", index);
+        return err;
+    }
+    if (text[0]) {
+        ESP_LOGI(TAG, "Strip %d mapping \"%s\", %"PRIu32" input pixels", index, text, strip->map.pixels);
+    }
+    return 0;
+}
+
+static int init_rmt_strip(int index, struct strip *strip, const led_strip_config_t *strip_config)
+{
+    struct strip_settings *settings = &strip->settings;
+    led_strip_rmt_config_t rmt_config = rmt_config_template;
+    rmt_config.user_ctx = strip;
+    rmt_config.mem_block_symbols = rmt_mem_symbols;
+    rmt_config.flags.with_dma = rmt_dma;
+
+    ESP_LOGI(TAG, "loading led strip %d on pin %"PRId32, index, settings->pin);
+    if (led_strip_new_rmt_device(strip_config, &rmt_config, &strip->handle) != ESP_OK) {
+        esp_err_t err = ESP_FAIL;
+        if (rmt_config.flags.with_dma) {
+            // Only some chips and channels can do DMA, the rest use ping-pong
+            ESP_LOGW(TAG, "No DMA for strip %d, falling back to interrupts", index);
+            rmt_config.flags.with_dma = false;
+            err = led_strip_new_rmt_device(strip_config, &rmt_config, &strip->handle);
+        }
+        if (err != ESP_OK) {
+            return -1;
+        }
+    }
+    strip->expected_us = (int64_t) settings->led_count * mapping_out_size(&strip->mapping) * 8 * WS2812_BIT_NS / 1000
+        + WS2812_RESET_US;
+    return 0;
+}
+
+static int init_clocked_strip(int index, struct strip *strip, const led_strip_config_t *strip_config)
+{
+    struct strip_settings *settings = &strip->settings;
+    if (strip_config->led_pixel_format != LED_PIXEL_FORMAT_GRB) {
+        ESP_LOGW(TAG, "Strip %d is clocked, those leds have no white channel", index);
+        return -1;
+    }
+    if (SPI2_HOST + spi_hosts_used >= SPI_HOST_MAX) {
+        ESP_LOGW(TAG, "No SPI bus left for strip %d", index);
+        return -1;
+    }
+    int32_t clock_khz = settings->clock_khz > 0 ? settings->clock_khz : RENDER_CLOCKED_DEFAULT_KHZ;
+    if (clock_khz > RENDER_CLOCKED_MAX_KHZ) {
+        ESP_LOGW(TAG, "Clock of strip %d out of range, using %d kHz", index, RENDER_CLOCKED_MAX_KHZ);
+        clock_khz = RENDER_CLOCKED_MAX_KHZ;
+    }
+    led_strip_config_t config = *strip_config;
+    config.led_model = settings->model == STRIP_SK9822 ? LED_MODEL_SK9822 : LED_MODEL_APA102;
+    led_strip_apa102_config_t apa102_config = apa102_config_template;
+    apa102_config.spi_bus = SPI2_HOST + spi_hosts_used;
+    apa102_config.clk_gpio_num = settings->clock_pin;
+    apa102_config.clock_speed_hz = clock_khz * 1000;
+    apa102_config.user_ctx = strip;
+
+    ESP_LOGI(TAG, "loading clocked led strip %d on pin %"PRId32", clock pin %"PRId32" at %"PRId32" kHz",
+            index, settings->pin, settings->clock_pin, clock_khz);
+    if (led_strip_new_apa102_device(&config, &apa102_config, &strip->handle) != ESP_OK) {
+        return -1;
+    }
+    spi_hosts_used++;
+    strip->expected_us = (int64_t) led_strip_apa102_frame_bytes(settings->led_count) * 8 * 1000 / clock_khz;
+    if (strip->expected_us < 1) {
+        // The wire period divides by it
+        strip->expected_us = 1;
+    }
+    return 0;
+}
+
+static int init_led_strip(int index)
+{
+    struct strip *strip = &strips[strip_count];
+    struct strip_settings *settings = &strip->settings;
+
+    if (load_strip_settings(index, settings) != ESP_OK ||
+            settings->led_count < 1 || settings->pin < 0) {
+        return 0;
+    }
+    if (settings->universe < 0 || settings->first_channel < 0 ||
+            settings->first_channel >= DMX_UNIVERSE_SIZE) {
+        ESP_LOGW(TAG, "Strip %d has an invalid universe or channel, skipping", index);
+        return 0;
+    }
+    if (settings->input < 0 || settings->input >= PIXEL_INPUT_COUNT) {
+        ESP_LOGW(TAG, "Strip %d has an unknown input mode, using rgbi", index);
+        settings->input = PIXEL_INPUT_RGBI;
+    }
+    if (settings->group < 1) {
+        settings->group = 1;
+    }
+    if (settings->model < 0 || settings->model >= STRIP_MODEL_COUNT) {
+        ESP_LOGW(TAG, "Strip %d has an unknown led model, using ws2812", index);
+        settings->model = STRIP_WS2812;
+    }
+    if (strip_clocked(strip) && settings->clock_pin < 0) {
+        ESP_LOGW(TAG, "Strip %d is clocked but has no clock pin, skipping", index);
+        return 0;
+    }
+    RETURN_ON_ERR(init_strip_mapping(index, strip));
+
+    led_strip_config_t strip_config = strip_config_template;
+    strip_config.max_leds = settings->led_count;
+    strip_config.led_pixel_format = mapping_out_size(&strip->mapping) == 4
+        ? LED_PIXEL_FORMAT_GRBW : LED_PIXEL_FORMAT_GRB;
+    strip_config.strip_gpio_num = settings->pin;
+
+    int err = strip_clocked(strip)
+        ? init_clocked_strip(index, strip, &strip_config)
+        : init_rmt_strip(index, strip, &strip_config);
+    if (err) {
+        mapping_free(&strip->map);
+        return -1;
+    }
+    if (init_strip_transform(index, strip)) {
+        // Still usable without gamma correction
+        ESP_LOGW(TAG, "Strip %d falls back to 8 bit output", index);
+    }
+    strip_count++;
+    return 0;
+}
+
+// The longest strip sets the highest rate frames can be sent at
+static void init_wire_period(void)
+{
+    for (int i = 0; i < strip_count; i++) {
+        if (strips[i].expected_us > wire_period) {
+            wire_period = strips[i].expected_us;
+        }
+    }
+    if (wire_period > 0) {
+        ESP_LOGI(TAG, "Frames take %"PRId64" us on the wire, up to %"PRId64" frames per second",
+                wire_period, 1000 * 1000 / wire_period);
+    }
+}
+
+static int init_led_strips(void)
+{
+    if (load_rmt_dma(&rmt_dma) != ESP_OK) {
+        rmt_dma = 0;
+    }
+    if (load_rmt_mem_symbols(&rmt_mem_symbols) != ESP_OK || rmt_mem_symbols < 0) {
+        rmt_mem_symbols = 0;
+    }
+    ESP_LOGI(TAG, "RMT DMA %s, %"PRId32" memory block symbols",
+            rmt_dma ? "on" : "off", rmt_mem_symbols);
+    late_margin_us = (rmt_mem_symbols ? rmt_mem_symbols : RMT_DEFAULT_MEM_SYMBOLS)
+        * WS2812_BIT_NS / 1000;
+
+    for (int i = 0; i < MAX_LED_STRIPS; i++) {
+        if (init_led_strip(i)) {
+            // Most likely out of RMT channels, keep the strips we got
+            ESP_LOGW(TAG, "Failed to initialize strip %d", i);
+        }
+    }
+    if (strip_count == 0) {
+        ESP_LOGW(TAG, "No led strips configured");
+        return -1;
+    }
+    return 0;
+}
+
+// Slots the given number of input pixels of the strip take
+static size_t input_slots(const struct strip *strip, uint32_t pixels)
+{
+    return pixels * pixel_map_channels(&strip->map);
+}
+
+/*
+ * Place the strips in the frame, which starts from the lowest
+ * universe in use and is just long enough for the furthest strip.
+ */
+static size_t map_strips(void)
+{
+    int32_t first_universe = strips[0].settings.universe;
+    for (int i = 1; i < strip_count; i++) {
+        if (strips[i].settings.universe < first_universe) {
+            first_universe = strips[i].settings.universe;
+        }
+    }
+    artnet_universe = first_universe;
+
+    size_t slots = 0;
+    for (int i = 0; i < strip_count; i++) {
+        struct strip *strip = &strips[i];
+        strip->frame_offset = (strip->settings.universe - first_universe) * DMX_UNIVERSE_SIZE
+            + strip->settings.first_channel;
+        size_t end = strip->frame_offset + input_slots(strip, strip->map.pixels);
+        if (end > slots) {
+            slots = end;
+        }
+    }
+    return slots;
+}
+
+// Clip the strips to the frame, which may be shorter than they need
+static void clip_strips(void)
+{
+    universe_mask = 0;
+    for (int i = 0; i < strip_count; i++) {
+        struct strip *strip = &strips[i];
+        uint32_t pixels = 0;
+        if (strip->frame_offset < frame_len) {
+            pixels = (frame_len - strip->frame_offset) / pixel_map_channels(&strip->map);
+        }
+        if (pixels < strip->map.pixels) {
+            ESP_LOGW(TAG, "Strip %d only gets data for %"PRIu32" of its %"PRIu32" pixels",
+                    i, pixels, strip->map.pixels);
+        } else {
+            pixels = strip->map.pixels;
+        }
+        strip->map.pixels = pixels;
+
+        if (!strip->map.index) {
+            strip->count = pixels;
+        } else {
+            // Leds of the pixels past the frame stay dark
+            strip->count = pixels ? strip->settings.led_count : 0;
+            for (uint32_t led = 0; led < strip->count; led++) {
+                if (strip->map.index[led] != PIXEL_DARK && strip->map.index[led] >= pixels) {
+                    strip->map.index[led] = PIXEL_DARK;
+                }
+            }
+        }
+        if (strip->count) {
+            size_t end = strip->frame_offset + input_slots(strip, pixels);
+            for (size_t u = strip->frame_offset / DMX_UNIVERSE_SIZE; u * DMX_UNIVERSE_SIZE < end; u++) {
+                universe_mask |= 1u << u;
+            }
+        }
+    }
+}
+
+/*
+ * Place the decoded strips in the front buffers, returns their length.
+ * Unless a strip needs decoding the front buffers are laid out as the
+ * frame, and the leds are sent straight from the input pixels.
+ */
+static size_t place_pixels(void)
+{
+    decoding = false;
+    for (int i = 0; i < strip_count; i++) {
+        if (strips[i].map.input != PIXEL_INPUT_RGBI || strips[i].map.index) {
+            decoding = true;
+        }
+    }
+
+    size_t len = 0;
+    for (int i = 0; i < strip_count; i++) {
+        struct strip *strip = &strips[i];
+        if (decoding) {
+            strip->pixel_offset = len;
+            strip->layout = pixel_decoded_layout(&strip->map);
+            len += strip->count * strip->layout.size;
+            ESP_LOGI(TAG, "Strip %d input %s, %"PRId32" leds per pixel", i,
+                    pixel_input_name(strip->map.input), strip->settings.group);
+        } else {
+            strip->pixel_offset = strip->frame_offset;
+            strip->layout = strip->map.layout;
+        }
+        mapping_transform(&strip->mapping, &strip->layout, &strip->transform);
+    }
+    if (!decoding) {
+        return frame_len;
+    }
+    return len ? len : pixel_layout_rgbi.size;
+}
+
+static int init_palette(void)
+{
+    bool used = false;
+    for (int i = 0; i < strip_count; i++) {
+        used |= strips[i].settings.input == PIXEL_INPUT_PALETTE;
+    }
+    if (!used) {
+        return 0;
+    }
+    palette = malloc(PIXEL_PALETTE_SIZE * 3);
+    if (!palette) {
+        ESP_LOGE(TAG, "No memory for the palette");
+        return -1;
+    }
+    if (load_palette(palette[0], PIXEL_PALETTE_SIZE * 3) != ESP_OK) {
+        ESP_LOGI(TAG, "No palette stored, using the default one");
+        pixel_default_palette(palette);
+    }
+    return 0;
+}
+
+#define LEDC_TIMER LEDC_TIMER_2
+// The timer runs from the APB clock, the resolution is worked out from it
+#define LEDC_SRC_CLK_HZ (80 * 1000 * 1000)
+// Input levels are 16 bits, more would not add anything
+#define LEDC_MAX_RESOLUTION (16)
+#define LEDC_CHANNEL_R LEDC_CHANNEL_1
+#define LEDC_CHANNEL_G LEDC_CHANNEL_3
+#define LEDC_CHANNEL_B LEDC_CHANNEL_5
+
+int render_ledc_resolution(int32_t freq_hz)
+{
+    if (freq_hz < RENDER_LEDC_MIN_FREQ || freq_hz > RENDER_LEDC_MAX_FREQ) {
+        return 0;
+    }
+    uint32_t bits = ledc_find_suitable_duty_resolution(LEDC_SRC_CLK_HZ, freq_hz);
+    if (bits > LEDC_MAX_RESOLUTION) {
+        bits = LEDC_MAX_RESOLUTION;
+    }
+    return bits >= 8 ? bits : 0;
+}
+
+static int init_led_rgb()
+{
+    int32_t freq, gamma;
+    if (load_ledc_freq(&freq) != ESP_OK) {
+        freq = RENDER_LEDC_DEFAULT_FREQ;
+    }
+    int bits = render_ledc_resolution(freq);
+    if (!bits) {
+        ESP_LOGW(TAG, "LEDC frequency %"PRId32" Hz out of range, using %d Hz", freq, RENDER_LEDC_DEFAULT_FREQ);
+        freq = RENDER_LEDC_DEFAULT_FREQ;
+        bits = render_ledc_resolution(freq);
+    }
+    ledc_timer_config_t ledc_timer = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .timer_num  = LEDC_TIMER,
+        .duty_resolution = bits,
+        .freq_hz         = freq,
+        .clk_cfg         = LEDC_USE_APB_CLK,
+    };
+    if (ledc_timer_config(&ledc_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "LEDC timer setup failed at %"PRId32" Hz, %d bits", freq, bits);
+        return -1;
+    }
+    ledc_max_duty = (1u << bits) - 1;
+    if (ledc_fade && ledc_fade_func_install(0) != ESP_OK) {
+        ESP_LOGW(TAG, "LEDC fade service failed, fading is off");
+        ledc_fade = false;
+    }
+
+    if (load_ledc_gamma(&gamma) == ESP_OK && gamma > 0) {
+        ledc_gamma = build_gamma(gamma);
+        if (!ledc_gamma) {
+            ESP_LOGW(TAG, "No memory for the LEDC gamma table, output is linear");
+        }
+    }
+    ESP_LOGI(TAG, "LEDC %"PRId32" Hz, %d bit duty, %s input, gamma %"PRId32".%"PRId32"%s",
+            freq, bits, ledc_wide ? "16 bit" : "8 bit",
+            ledc_gamma ? gamma / 10 : 1, ledc_gamma ? gamma % 10 : 0,
+            ledc_fade ? ", hardware fades" : "");
+
+    ledc_channel_config_t ledc_r_channel = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel    = LEDC_CHANNEL_R,
+        .timer_sel  = LEDC_TIMER,
+        .intr_type  = LEDC_INTR_DISABLE,
+        .gpio_num   = -1,
+        .duty       = 0,
+        .hpoint     = 50
+    };
+
+    ledc_channel_config_t ledc_g_channel = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel    = LEDC_CHANNEL_G,
+        .timer_sel  = LEDC_TIMER,
+        .intr_type  = LEDC_INTR_DISABLE,
+        .gpio_num   = -1,
+        .duty       = 0,
+        .hpoint     = 0
+    };
+
+    ledc_channel_config_t ledc_b_channel = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel    = LEDC_CHANNEL_B,
+        .timer_sel  = LEDC_TIMER,
+        .intr_type  = LEDC_INTR_DISABLE,
+        .gpio_num   = -1,
+        .duty       = 0,
+        .hpoint     = 0
+    };
+
+    int32_t rpin, gpin, bpin;
+    if (load_ledc_pins(&rpin, &gpin, &bpin) == ESP_OK)
+    {
+        ESP_LOGI(TAG, "loading ledc");
+        if (rpin >= 0) {
+            ledc_r_channel.gpio_num = rpin;
+            ESP_LOGI(TAG, "r pin: %d", ledc_r_channel.gpio_num);
+            ledc_channel_config(&ledc_r_channel);
+        }
+        if (gpin >= 0) {
+            ledc_g_channel.gpio_num = gpin;
+            ESP_LOGI(TAG, "g pin: %d", ledc_g_channel.gpio_num);
+            ledc_channel_config(&ledc_g_channel);
+        }
+        if (bpin >= 0) {
+            ledc_b_channel.gpio_num = bpin;
+            ESP_LOGI(TAG, "b pin: %d", ledc_b_channel.gpio_num);
+            ledc_channel_config(&ledc_b_channel);
+        }
+    }
+
+    return 0;
+}
+
+static int init_frame_buffers(size_t slots)
+{
+    universe_count = (slots + DMX_UNIVERSE_SIZE - 1) / DMX_UNIVERSE_SIZE;
+    if (universe_count > RENDER_MAX_UNIVERSES) {
+        ESP_LOGW(TAG, "Strip needs %u universes, only using the first %d",
+                universe_count, RENDER_MAX_UNIVERSES);
+        universe_count = RENDER_MAX_UNIVERSES;
+    }
+    frame_len = universe_count * DMX_UNIVERSE_SIZE;
+
+    back_buf = calloc(1, frame_len);
+    if (!back_buf) {
+        ESP_LOGE(TAG, "No memory for %u universe frame buffers", universe_count);
+        return -1;
+    }
+    ESP_LOGI(TAG, "Frame spans %u universes", universe_count);
+    return 0;
+}
+
+// The render task does nothing while back_buf is NULL
+static int init_front_buffers(size_t len)
+{
+    output_len = len;
+    front_bufs[0] = calloc(1, output_len);
+    front_bufs[1] = calloc(1, output_len);
+    if (!front_bufs[0] || !front_bufs[1]) {
+        ESP_LOGE(TAG, "No memory for the front buffers");
+        free(back_buf);
+        free(front_bufs[0]);
+        free(front_bufs[1]);
+        back_buf = front_bufs[0] = front_bufs[1] = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int32_t render_first_universe(void)
+{
+    return artnet_universe;
+}
+
+unsigned int render_universe_count(void)
+{
+    return universe_count;
+}
+
+uint32_t render_universe_mask(void)
+{
+    return universe_mask;
+}
+
+static void render_tick(void *arg)
+{
+    xTaskNotify(task_handle, NOTIFY_TICK, eSetBits);
+}
+
+static int init_fade_buffers(void)
+{
+    if (fade_from) {
+        return 0;
+    }
+    fade_from = calloc(1, output_len);
+    fade_to = calloc(1, output_len);
+    if (!fade_from || !fade_to) {
+        free(fade_from);
+        free(fade_to);
+        fade_from = fade_to = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int init_fixed_rate(void)
+{
+    if (load_render_rate(&render_rate) != ESP_OK || render_rate <= 0) {
+        render_rate = 0;
+        return 0;
+    }
+    if (render_rate > RENDER_MAX_RATE) {
+        render_rate = RENDER_MAX_RATE;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = render_tick,
+        .name = "render",
+        .skip_unhandled_events = true,
+    };
+    if (init_fade_buffers() || esp_timer_create(&timer_args, &tick_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up fixed rate rendering");
+        render_rate = 0;
+        return -1;
+    }
+    ESP_LOGI(TAG, "Rendering at %"PRId32" Hz", render_rate);
+    return 0;
+}
+
+static int init_loss_watchdog(void)
+{
+    int32_t val;
+    if (load_loss_timeout(&val) != ESP_OK || val <= 0) {
+        return 0;
+    }
+    loss_timeout = val * 1000LL;
+    loss_policy = load_loss_policy(&val) == ESP_OK ? (enum loss_policy) val : LOSS_HOLD;
+    loss_fade = load_loss_fade(&val) == ESP_OK && val > 0 ? val * 1000LL : 0;
+    if (loss_policy == LOSS_HOLD) {
+        ESP_LOGI(TAG, "Holding the last frame on stream loss");
+        return 0;
+    }
+
+    loss_target = calloc(1, output_len);
+    if (!loss_target || init_fade_buffers()) {
+        ESP_LOGE(TAG, "No memory for the stream loss fade, holding instead");
+        free(loss_target);
+        loss_target = NULL;
+        loss_policy = LOSS_HOLD;
+        return -1;
+    }
+    if (loss_policy == LOSS_SCENE && load_loss_scene(loss_target, output_len) != ESP_OK) {
+        ESP_LOGW(TAG, "No stream loss scene stored, fading to black");
+    }
+    ESP_LOGI(TAG, "Fading to %s over %"PRId64" ms on stream loss",
+            loss_policy == LOSS_SCENE ? "the scene" : "black", loss_fade / 1000);
+    return 0;
+}
+
+int render_init(void)
+{
+    int32_t val;
+    int err;
+
+    frame_lock = xSemaphoreCreateMutexStatic(&frame_lock_buffer);
+    output_lock = xSemaphoreCreateMutexStatic(&output_lock_buffer);
+
+    if (load_render_keepalive(&val) != ESP_OK || val < 0) {
+        val = DEFAULT_KEEPALIVE_MS;
+    }
+    keepalive = val * 1000LL;
+
+    if (load_led_type(&val) == ESP_OK)
+    {
+        led_type = (enum led_type) val;
+        if (led_type == LED_STRIP)
+        {
+            ESP_LOGI(TAG, "Initializing led strips");
+            RETURN_ON_ERR(init_led_strips());
+            init_wire_period();
+            RETURN_ON_ERR(init_palette());
+            RETURN_ON_ERR(init_frame_buffers(map_strips()));
+            clip_strips();
+            RETURN_ON_ERR(init_front_buffers(place_pixels()));
+            init_fixed_rate();
+            init_loss_watchdog();
+            return 0;
+        }
+
+        err = load_artnet_universe(&artnet_universe);
+        if (err) {
+            ESP_LOGW(TAG, "No artnet universe configured, defaulting to 0");
+            artnet_universe = 0;
+        }
+        err = load_artnet_first_channel(&artnet_first_channel);
+        if (err) {
+            ESP_LOGW(TAG, "No artnet first channel configured, bailing");
+            led_type = LED_NONE;
+            return err;
+        }
+        ledc_wide = load_ledc_wide(&val) == ESP_OK && val;
+        ledc_fade = load_ledc_fade(&val) == ESP_OK && val;
+        if (artnet_first_channel < 0 || artnet_first_channel + ledc_slots() > DMX_UNIVERSE_SIZE) {
+            ESP_LOGW(TAG, "Artnet first channel %"PRId32" out of range, bailing", artnet_first_channel);
+            led_type = LED_NONE;
+            return -1;
+        }
+
+        if (led_type == LED_RGB)
+        {
+            ESP_LOGI(TAG, "Initializing a single rgb led");
+            RETURN_ON_ERR(init_led_rgb());
+            RETURN_ON_ERR(init_frame_buffers(DMX_UNIVERSE_SIZE));
+            RETURN_ON_ERR(init_front_buffers(frame_len));
+            if (ledc_fade) {
+                ESP_LOGI(TAG, "Fading in hardware, no fixed rate rendering");
+            } else {
+                init_fixed_rate();
+            }
+            init_loss_watchdog();
+            return 0;
+        }
+        else
+        {
+            ESP_LOGI(TAG, "No leds");
+        }
+    }
+    else
+    {
+        led_type = LED_NONE;
+    }
+    return 0;
+}
+
+bool render_write(unsigned int universe_index, const uint8_t *data, size_t len, int64_t rx_time_us)
+{
+    if (universe_index >= universe_count) {
+        return false;
+    }
+    if (len > DMX_UNIVERSE_SIZE) {
+        len = DMX_UNIVERSE_SIZE;
+    }
+    return render_write_at(universe_index * DMX_UNIVERSE_SIZE, data, len, rx_time_us);
+}
+
+bool render_write_at(size_t offset, const uint8_t *data, size_t len, int64_t rx_time_us)
+{
+    if (!back_buf || offset >= frame_len || len == 0) {
+        return false;
+    }
+    if (len > frame_len - offset) {
+        len = frame_len - offset;
+    }
+    unsigned int first = offset / DMX_UNIVERSE_SIZE;
+    unsigned int last = (offset + len - 1) / DMX_UNIVERSE_SIZE;
+    uint32_t touched = (2u << last) - (1u << first);
+
+    xSemaphoreTake(frame_lock, portMAX_DELAY);
+    bool coalesced = back_dirty & touched;
+    if (!keepalive || !back_latched || memcmp(&back_buf[offset], data, len) != 0) {
+        memcpy(&back_buf[offset], data, len);
+        if (!back_dirty) {
+            back_rx_time = rx_time_us;
+        }
+        back_dirty |= touched;
+    }
+    back_received = true;
+    xSemaphoreGive(frame_lock);
+    return coalesced;
+}
+
+size_t render_frame_len(void)
+{
+    return frame_len;
+}
+
+void render_commit(void)
+{
+    if (task_handle) {
+        xTaskNotify(task_handle, NOTIFY_FRAME, eSetBits);
+    }
+}
+
+static void render_strip(const uint8_t *frame, int64_t rx_time)
+{
+    int64_t start = esp_timer_get_time();
+    // The previous frame is done by now, account it before tracking this one
+    account_refresh_done();
+    if (rx_time && start - rx_time > wire_period + late_margin_us) {
+        stats.missed++;
+    }
+    // The RGBI slots are converted while they are encoded for the wire.
+    // The strips are refreshed back to back without waiting, so they
+    // are all clocked out at the same time
+    bool sent = false;
+    for (int i = 0; i < strip_count; i++)
+    {
+        struct strip *strip = &strips[i];
+        strip->sent = false;
+        if (strip->count) {
+            // A failed refresh never calls back, so it is not waited for
+            strip->sent = led_strip_refresh_from(strip->handle, &frame[strip->pixel_offset],
+                    strip->count, &strip->transform) == ESP_OK;
+            if (!strip->sent) {
+                stats.failed++;
+            }
+            sent |= strip->sent;
+        }
+    }
+    int64_t refreshed = esp_timer_get_time();
+    inflight_start = sent ? start : 0;
+    inflight_rx_time = rx_time;
+
+    timing_add(&stats.refresh, refreshed - start);
+}
+
+// The n:th slot of the single led as a 16 bit level, gamma corrected
+static uint32_t ledc_level(const uint8_t *led, int n)
+{
+    uint32_t level = ledc_wide ? led[2 * n] << 8 | led[2 * n + 1] : led[n] * 257;
+    if (!ledc_gamma) {
+        return level;
+    }
+    // Position in the 256 entry table, 16 bit fixed point
+    uint32_t pos = level * 255;
+    uint32_t i = pos / 65535;
+    uint32_t frac = pos % 65535;
+    if (i == 255) {
+        return ledc_gamma[255];
+    }
+    return ledc_gamma[i] + (uint32_t) (ledc_gamma[i + 1] - ledc_gamma[i]) * frac / 65535;
+}
+
+// Color times intensity, both 16 bits, to duty
+static uint32_t ledc_duty(uint32_t color, uint32_t intensity)
+{
+    const uint64_t full = 65535ULL * 65535;
+    return ((uint64_t) color * intensity * ledc_max_duty + full / 2) / full;
+}
+
+static void set_ledc_duty(int n, ledc_channel_t channel, uint32_t duty)
+{
+    if (duty == ledc_duty_set[n]) {
+        return;
+    }
+    ledc_duty_set[n] = duty;
+#if SOC_LEDC_SUPPORT_FADE_STOP
+    // Retarget a fade still running, starting a new one would wait for it
+    if (ledc_fade) {
+        ledc_fade_stop(LEDC_LOW_SPEED_MODE, channel);
+    }
+#endif
+    // The fade takes whole milliseconds, shorter ones are jumps
+    if (!ledc_fade || ledc_fade_time < 1000) {
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, duty);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, channel);
+        return;
+    }
+    ledc_set_fade_time_and_start(LEDC_LOW_SPEED_MODE, channel, duty,
+            ledc_fade_time / 1000, LEDC_FADE_NO_WAIT);
+    stats.ledc_fades++;
+}
+
+static void render_rgb(const uint8_t *frame, int64_t rx_time)
+{
+    int64_t start = esp_timer_get_time();
+    const uint8_t *led = &frame[artnet_first_channel];
+    uint32_t i = ledc_level(led, offsetof(struct led_rgbi, i));
+    uint32_t r = ledc_duty(ledc_level(led, offsetof(struct led_rgbi, r)), i);
+    uint32_t g = ledc_duty(ledc_level(led, offsetof(struct led_rgbi, g)), i);
+    uint32_t b = ledc_duty(ledc_level(led, offsetof(struct led_rgbi, b)), i);
+    int64_t converted = esp_timer_get_time();
+    set_ledc_duty(0, LEDC_CHANNEL_R, r);
+    set_ledc_duty(1, LEDC_CHANNEL_G, g);
+    set_ledc_duty(2, LEDC_CHANNEL_B, b);
+    int64_t refreshed = esp_timer_get_time();
+
+    timing_add(&stats.convert, converted - start);
+    timing_add(&stats.refresh, refreshed - converted);
+    if (rx_time) {
+        timing_add(&stats.total, refreshed - rx_time);
+    }
+}
+
+// This will block for one second
+static void show_ready(void)
+{
+    if (led_type == LED_STRIP && strip_count)
+    {
+        for (int i = 0; i < strip_count; i++) {
+            led_strip_set_pixel(strips[i].handle, 0, 0, 200, 0);
+            led_strip_refresh(strips[i].handle);
+        }
+        vTaskDelay(pdMS_TO_TICKS(500));
+        for (int i = 0; i < strip_count; i++) {
+            led_strip_set_pixel(strips[i].handle, 0, 0, 0, 0);
+            led_strip_refresh(strips[i].handle);
+        }
+    }
+    else
+    {
+        ESP_LOGW(TAG, "No ledstrip for showing ready state");
+    }
+}
+
+// rx_time is 0 for a frame sent again
+static void output_frame(const uint8_t *frame, int64_t rx_time)
+{
+    xSemaphoreTake(output_lock, portMAX_DELAY);
+    if (led_type == LED_STRIP)
+    {
+        render_strip(frame, rx_time);
+    }
+    else if (led_type == LED_RGB)
+    {
+        render_rgb(frame, rx_time);
+    }
+    front ^= 1;
+    shown = true;
+    last_output_time = esp_timer_get_time();
+    xSemaphoreGive(output_lock);
+}
+
+// back_buf to the front buffer layout, called with frame_lock held
+static void decode_frame(uint8_t *dst)
+{
+    if (!decoding) {
+        memcpy(dst, back_buf, frame_len);
+        return;
+    }
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < strip_count; i++) {
+        struct strip *strip = &strips[i];
+        if (strip->count) {
+            pixel_decode(&strip->map, (const uint8_t (*)[3]) palette,
+                    &back_buf[strip->frame_offset], &dst[strip->pixel_offset], strip->count);
+        }
+    }
+    timing_add(&stats.decode, esp_timer_get_time() - start);
+}
+
+enum latch {
+    LATCH_NONE,         // nothing arrived
+    LATCH_UNCHANGED,    // frames arrived, all the same as the one latched before
+    LATCH_NEW,          // dst holds a new frame
+};
+
+/*
+ * Decode back_buf to dst if something was written to it since the last
+ * latch. After a stream loss the first frame is new even if unchanged,
+ * the leds show the loss fade.
+ */
+static enum latch latch_frame(uint8_t *dst, int64_t *rx_time)
+{
+    xSemaphoreTake(frame_lock, portMAX_DELAY);
+    bool received = back_received;
+    bool dirty = back_dirty || (received && lost);
+    if (dirty) {
+        decode_frame(dst);
+        back_latched = true;
+    }
+    *rx_time = back_rx_time;
+    back_dirty = 0;
+    back_received = false;
+    xSemaphoreGive(frame_lock);
+
+    if (!received) {
+        return LATCH_NONE;
+    }
+    // Unchanged frames keep the stream alive too
+    last_frame_time = esp_timer_get_time();
+    if (!dirty) {
+        return LATCH_UNCHANGED;
+    }
+    timing_add(&stats.latch, last_frame_time - *rx_time);
+    if (lost) {
+        ESP_LOGI(TAG, "Stream is back");
+        lost = false;
+        // Stop a loss fade, the new frame takes over
+        fade_done = true;
+    }
+    return LATCH_NEW;
+}
+
+// Fade from what is on the leds to target, NULL for black
+static void start_fade(const uint8_t *target, int64_t duration)
+{
+    if (shown) {
+        memcpy(fade_from, front_bufs[front ^ 1], output_len);
+    } else {
+        memset(fade_from, 0, output_len);
+    }
+    if (target) {
+        memcpy(fade_to, target, output_len);
+    } else {
+        memset(fade_to, 0, output_len);
+    }
+    if (ledc_fade) {
+        // The LEDC ramps there by itself
+        uint8_t *front_buf = front_bufs[front];
+        memcpy(front_buf, fade_to, output_len);
+        ledc_fade_time = duration;
+        output_frame(front_buf, 0);
+        return;
+    }
+    fade_start = esp_timer_get_time();
+    fade_duration = duration;
+    fade_rx_time = 0;
+    fade_done = false;
+}
+
+/*
+ * When the next loss fade step is due. The steps are on a grid from the
+ * fade start, so the fade takes loss_fade however often the task wakes.
+ */
+static int64_t loss_fade_next_step(void)
+{
+    int64_t step = LOSS_FADE_STEP_MS * 1000;
+    if (last_output_time < fade_start) {
+        return fade_start;
+    }
+    return fade_start + ((last_output_time - fade_start) / step + 1) * step;
+}
+
+static void check_loss(void)
+{
+    if (!loss_timeout || lost || !last_frame_time ||
+            esp_timer_get_time() - last_frame_time < loss_timeout) {
+        return;
+    }
+    lost = true;
+    stats.losses++;
+    ESP_LOGW(TAG, "No frames for %"PRId64" ms", loss_timeout / 1000);
+    if (loss_policy != LOSS_HOLD) {
+        start_fade(loss_target, loss_fade);
+    }
+}
+
+/*
+ * The strips are still sending the last frame. A refresh done callback
+ * that is long overdue is not waited for, the refresh blocks instead.
+ */
+static bool wire_busy(void)
+{
+    bool late;
+    if (led_type != LED_STRIP || !inflight_start || frame_done_time(inflight_start, &late)) {
+        return false;
+    }
+    return esp_timer_get_time() < inflight_start + wire_period + late_margin_us;
+}
+
+// How long the render task can sleep without missing anything
+static TickType_t next_timeout(void)
+{
+    int64_t wait = -1;
+    if (wire_busy()) {
+        // Normally the refresh done callbacks wake the task up before this
+        wait = inflight_start + wire_period + late_margin_us - esp_timer_get_time();
+    }
+    if (!render_rate && (!fade_done || dithering)) {
+        // Deadlines from absolute times, wire wakeups don't push them back
+        int64_t due = fade_done ? last_output_time + DITHER_PERIOD_MS * 1000 : loss_fade_next_step();
+        int64_t step = due - esp_timer_get_time();
+        if (step < 0) {
+            step = 0;
+        }
+        if (wait < 0 || step < wait) {
+            wait = step;
+        }
+    }
+    if (loss_timeout && !lost && last_frame_time) {
+        int64_t until_loss = last_frame_time + loss_timeout - esp_timer_get_time();
+        if (until_loss < 0) {
+            until_loss = 0;
+        }
+        if (wait < 0 || until_loss < wait) {
+            wait = until_loss;
+        }
+    }
+    if (wait < 0) {
+        return portMAX_DELAY;
+    }
+    TickType_t ticks = pdMS_TO_TICKS((wait + 999) / 1000);
+    return ticks ? ticks : 1;
+}
+
+/*
+ * Smooth the interval between frames a bit, delivery is jittery. After
+ * a pause the fade time is kept, the next frame is not faded in slowly.
+ */
+static void measure_interval(int64_t previous)
+{
+    int64_t interval = last_frame_time - previous;
+    if (previous && interval <= MAX_FADE_US) {
+        frame_interval = frame_interval ? (frame_interval * 3 + interval) / 4 : interval;
+    }
+}
+
+// Fade time of a new frame of the single led, from its fade slot
+static void set_ledc_fade_time(const uint8_t *frame, int64_t previous)
+{
+    measure_interval(previous);
+    uint8_t tenths = frame[artnet_first_channel + ledc_slots() - 1];
+    ledc_fade_time = tenths ? tenths * 100 * 1000LL : frame_interval;
+}
+
+// Start fading from what is on the leds to the newest frame
+static void fade_latch(void)
+{
+    int64_t rx_time;
+    int64_t previous = last_frame_time;
+
+    enum latch latched = latch_frame(fade_to, &rx_time);
+    if (latched == LATCH_UNCHANGED) {
+        stats.unchanged++;
+    }
+    if (latched != LATCH_NEW) {
+        return;
+    }
+    if (shown) {
+        // The last frame sent
+        memcpy(fade_from, front_bufs[front ^ 1], output_len);
+    } else {
+        // Nothing to fade from on the first frame
+        memcpy(fade_from, fade_to, output_len);
+    }
+
+    measure_interval(previous);
+    fade_start = last_frame_time;
+    fade_duration = frame_interval;
+    fade_rx_time = rx_time;
+    fade_done = false;
+    stats.rendered++;
+}
+
+static void fade_tick(uint8_t *front_buf)
+{
+    if (fade_done && !dithering) {
+        // Holding the last frame, it is already on the leds. It is
+        // only sent again once keepalive has passed.
+        if (!keepalive || esp_timer_get_time() - last_output_time < keepalive) {
+            return;
+        }
+        stats.keepalives++;
+    }
+    int64_t elapsed = esp_timer_get_time() - fade_start;
+    uint32_t weight = 256;
+    if (fade_duration > 0 && elapsed < fade_duration) {
+        weight = elapsed * 256 / fade_duration;
+    }
+    if (weight >= 256) {
+        memcpy(front_buf, fade_to, output_len);
+        fade_done = true;
+    } else {
+        for (size_t i = 0; i < output_len; i++) {
+            int from = fade_from[i];
+            front_buf[i] = from + (((fade_to[i] - from) * (int) weight) >> 8);
+        }
+        if (led_type == LED_RGB && ledc_wide) {
+            // Coarse/fine pairs fade as one level, or the fine slot would wrap
+            for (size_t i = artnet_first_channel; i < artnet_first_channel + LEDC_WIDE_SLOTS; i += 2) {
+                int from = fade_from[i] << 8 | fade_from[i + 1];
+                int to = fade_to[i] << 8 | fade_to[i + 1];
+                int level = from + (((to - from) * (int) weight) >> 8);
+                front_buf[i] = level >> 8;
+                front_buf[i + 1] = level;
+            }
+        }
+    }
+    output_frame(front_buf, fade_rx_time);
+    fade_rx_time = 0;
+    stats.ticks++;
+}
+
+// A committed frame waits in back_buf for the strips to be done
+static bool frame_deferred;
+
+static void render_worker(void *bogus)
+{
+    show_ready();
+
+    if (render_rate) {
+        esp_timer_start_periodic(tick_timer, 1000 * 1000 / render_rate);
+    }
+
+    while (1) {
+        uint32_t notified = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &notified, next_timeout());
+
+        if (!back_buf) {
+            continue;
+        }
+
+        // The other front buffer may still be on the wire
+        uint8_t *front_buf = front_bufs[front];
+        if (render_rate) {
+            if (notified & NOTIFY_FRAME) {
+                fade_latch();
+            }
+            check_loss();
+            if (notified & NOTIFY_TICK) {
+                if (wire_busy()) {
+                    // Faster than the strips can take, skip this tick
+                    stats.deferred++;
+                } else {
+                    fade_tick(front_buf);
+                }
+            }
+            continue;
+        }
+        check_loss();
+        if (wire_busy()) {
+            // Frames arriving meanwhile are coalesced in back_buf, the
+            // freshest one is latched once the strips are done
+            if (notified & NOTIFY_FRAME) {
+                stats.deferred++;
+                frame_deferred = true;
+            }
+            continue;
+        }
+        if (frame_deferred) {
+            // Latch it now even if the wait only timed out
+            notified |= NOTIFY_FRAME;
+            frame_deferred = false;
+        }
+        if (!(notified & NOTIFY_FRAME)) {
+            // Woken by the wire or a timeout, there is nothing to latch
+            int64_t now = esp_timer_get_time();
+            if (!fade_done) {
+                // Stream loss fade
+                if (now >= loss_fade_next_step()) {
+                    fade_tick(front_buf);
+                }
+            } else if (dithering && stats.rendered && now - last_output_time >= DITHER_PERIOD_MS * 1000) {
+                // Send the last frame again, the back buffer may hold a
+                // partial one. The copy is not on the wire anymore.
+                memcpy(front_buf, front_bufs[front ^ 1], output_len);
+                output_frame(front_buf, 0);
+                stats.redrawn++;
+            }
+            continue;
+        }
+
+        int64_t rx_time;
+        int64_t previous = last_frame_time;
+        enum latch latched = latch_frame(front_buf, &rx_time);
+        if (latched == LATCH_NONE) {
+            continue;
+        }
+        if (latched == LATCH_UNCHANGED) {
+            if (esp_timer_get_time() - last_output_time < keepalive) {
+                stats.unchanged++;
+                continue;
+            }
+            // The same frame again, the copy is not on the wire anymore
+            memcpy(front_buf, front_bufs[front ^ 1], output_len);
+            stats.keepalives++;
+            rx_time = 0;
+        }
+        if (ledc_fade) {
+            set_ledc_fade_time(front_buf, previous);
+        }
+
+        output_frame(front_buf, rx_time);
+        stats.rendered++;
+    }
+}
+
+void render_print_stats(void)
+{
+    printf("frames rendered: %"PRIu32", late on the wire: %"PRIu32"\n", stats.rendered, stats.late);
+    if (stats.failed) {
+        printf("strip refreshes failed: %"PRIu32"\n", stats.failed);
+    }
+    if (led_type == LED_STRIP) {
+        printf("wire period: %"PRId64" us, commits deferred: %"PRIu32", deadline misses: %"PRIu32"\n",
+                wire_period, stats.deferred, stats.missed);
+    }
+    if (dithering && !render_rate) {
+        printf("frames sent again for dithering: %"PRIu32"\n", stats.redrawn);
+    }
+    if (keepalive) {
+        // What the skipped frames would have cost, at the average
+        int64_t cost = 0;
+        if (stats.decode.count) {
+            cost += stats.decode.total_us / stats.decode.count;
+        }
+        // At a fixed rate the ticks stop after the fade anyway, only the decode is saved
+        if (stats.refresh.count && !render_rate) {
+            cost += (stats.convert.total_us + stats.refresh.total_us) / stats.refresh.count;
+        }
+        printf("unchanged frames skipped: %"PRIu32", sent as keepalive: %"PRIu32
+                ", about %"PRId64" ms of cpu saved\n",
+                stats.unchanged, stats.keepalives, stats.unchanged * cost / 1000);
+    }
+    if (ledc_fade) {
+        printf("ledc channel fades: %"PRIu32", fade time: %"PRId64" us\n",
+                stats.ledc_fades, ledc_fade_time);
+    }
+    if (render_rate) {
+        printf("frames sent at %"PRId32" Hz: %"PRIu32", fade time: %"PRId64" us\n",
+                render_rate, stats.ticks, frame_interval);
+    }
+    if (loss_timeout) {
+        printf("stream losses: %"PRIu32"%s\n", stats.losses, lost ? ", lost now" : "");
+    }
+    timing_print("latch", &stats.latch);
+    if (decoding) {
+        timing_print("decode", &stats.decode);
+    }
+    timing_print("convert", &stats.convert);
+    timing_print("refresh", &stats.refresh);
+    timing_print("wire", &stats.wire);
+    timing_print("total", &stats.total);
+}
+
+int render_store_loss_scene(void)
+{
+    if (!back_buf || !shown) {
+        printf("Nothing shown on the leds yet\n");
+        return 1;
+    }
+    uint8_t *scene = malloc(output_len);
+    if (!scene) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    xSemaphoreTake(output_lock, portMAX_DELAY);
+    memcpy(scene, front_bufs[front ^ 1], output_len);
+    xSemaphoreGive(output_lock);
+    int err = save_loss_scene(scene, output_len);
+    free(scene);
+    return err;
+}
+
+int render_bench_refresh(unsigned int frames)
+{
+    if (led_type != LED_STRIP || !strip_count) {
+        printf("No led strips configured\n");
+        return 1;
+    }
+    struct timing wire = {0};
+    uint32_t late_frames = 0;
+    uint32_t failed = 0;
+    uint32_t timeouts = 0;
+    int64_t expected = 0;
+    uint8_t *pattern = malloc(output_len);
+    if (!pattern) {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    xSemaphoreTake(output_lock, portMAX_DELAY);
+    for (int i = 0; i < strip_count; i++) {
+        if (strips[i].expected_us > expected) {
+            expected = strips[i].expected_us;
+        }
+    }
+    for (unsigned int frame = 0; frame < frames; frame++) {
+        // A dim dot running along the strips
+        for (int i = 0; i < strip_count; i++) {
+            struct strip *strip = &strips[i];
+            if (!strip->count) {
+                continue;
+            }
+            const struct pixel_layout *layout = &strip->layout;
+            uint8_t *led = &pattern[strip->pixel_offset];
+            for (uint32_t j = 0; j < strip->count; j++, led += layout->size) {
+                uint8_t level = j == frame % strip->count ? 32 : (frame & 1) * 2;
+                memset(led, 0, layout->size);
+                led[layout->red] = led[layout->green] = led[layout->blue] = level;
+                if (layout->intensity >= 0) {
+                    led[layout->intensity] = 255;
+                }
+            }
+        }
+        int64_t start = esp_timer_get_time();
+        bool sent = false;
+        for (int i = 0; i < strip_count; i++) {
+            struct strip *strip = &strips[i];
+            strip->sent = false;
+            if (!strip->count) {
+                continue;
+            }
+            // A strip that failed is not waited for, it has no refresh done callback coming
+            strip->sent = led_strip_refresh_from(strip->handle, &pattern[strip->pixel_offset],
+                    strip->count, &strip->transform) == ESP_OK;
+            if (!strip->sent) {
+                failed++;
+            }
+            sent |= strip->sent;
+        }
+        if (!sent) {
+            continue;
+        }
+        // Wait for the frame to be out, so every frame is measured alone.
+        // A callback that never comes must not hang the console.
+        int64_t deadline = start + 10 * expected + late_margin_us;
+        bool late;
+        int64_t done;
+        while (!(done = frame_done_time(start, &late)) && esp_timer_get_time() < deadline) {
+            vTaskDelay(1);
+        }
+        if (!done) {
+            timeouts++;
+            continue;
+        }
+        timing_add(&wire, done - start);
+        if (late) {
+            late_frames++;
+        }
+    }
+    for (int i = 0; i < strip_count; i++) {
+        led_strip_clear(strips[i].handle);
+    }
+    // The render task accounts frames by refresh time, skip this one
+    inflight_start = 0;
+    xSemaphoreGive(output_lock);
+    free(pattern);
+
+    printf("RMT DMA %s, %"PRId32" memory block symbols\n", rmt_dma ? "on" : "off", rmt_mem_symbols);
+    printf("expected wire time %"PRId64" us, late margin %"PRId64" us\n", expected, late_margin_us);
+    timing_print("wire", &wire);
+    printf("late frames: %"PRIu32"/%u\n", late_frames, frames);
+    if (failed || timeouts) {
+        printf("failed refreshes: %"PRIu32", frames not done in time: %"PRIu32"\n", failed, timeouts);
+        return 1;
+    }
+    return 0;
+}
+
+void render_task_start(void)
+{
+    render_init();
+
+    // Lower priority than the receiver, so incoming packets
+    // are drained while a frame is being clocked out
+    task_handle = xTaskCreateStatic(
+            render_worker,
+            "render",
+            STACK_SIZE,
+            (void*) 0,
+            4,
+            xStack,
+            &xTaskBuffer
+            );
+}
@@ -0,0 +1,105 @@
+#ifndef _RENDER_H
+#define _RENDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DMX_UNIVERSE_SIZE 512
+// A strip can span this many consecutive universes
+#define RENDER_MAX_UNIVERSES 8
+
+/*
+ * The render pipeline is split in two:
+ *
+ *  - Receivers (art-net) copy slot data into the back buffer
+ *    with render_write() and call render_commit() once a frame
+ *    is complete, i.e. every universe of it has arrived.
+ *  - The render task latches the back buffer into the front
+ *    buffer, converts it and drives the leds, so a long strip
+ *    being clocked out does not stall the network receive.
+ *
+ * With a render rate configured the leds are instead driven at that
+ * rate, crossfading to each new frame over the measured interval
+ * between frames, so uneven delivery does not show in fades.
+ */
+
+// Highest configurable render rate in Hz
+#define RENDER_MAX_RATE 400
+
+int render_init(void);
+void render_task_start(void);
+
+/*
+ * The frame is assembled from render_universe_count() consecutive
+ * universes starting from render_first_universe(), the lowest
+ * universe used by any of the configured strips.
+ */
+int32_t render_first_universe(void);
+unsigned int render_universe_count(void);
+/*
+ * Bit n is set if universe render_first_universe() + n is read by
+ * a strip, a frame is complete when all of these have arrived.
+ */
+uint32_t render_universe_mask(void);
+
+/*
+ * Copy len bytes of slot data of the universe_index:th universe
+ * of the frame into the back buffer.
+ * rx_time_us is the esp_timer time the data was received,
+ * used for measuring the receive to output latency.
+ *
+ * Returns true if the write replaced data the render task
+ * had not latched yet, i.e. an older frame was coalesced away.
+ */
+bool render_write(unsigned int universe_index, const uint8_t *data, size_t len, int64_t rx_time_us);
+
+/*
+ * Same for receivers not bound to universes: offset counts slots from
+ * the first slot of the first universe, so the strip mapping is the
+ * same. Data past the frame is dropped.
+ */
+bool render_write_at(size_t offset, const uint8_t *data, size_t len, int64_t rx_time_us);
+
+// Slots in the frame, render_universe_count() universes
+size_t render_frame_len(void);
+
+/*
+ * Mark the back buffer as a complete frame and wake up
+ * the render task.
+ */
+void render_commit(void);
+
+void render_print_stats(void);
+
+/*
+ * Store the frame on the leds as the scene shown on stream loss,
+ * taken into use on the next boot. It is stored decoded, so store
+ * it again after changing the strips or their input modes.
+ */
+int render_store_loss_scene(void);
+
+/*
+ * Take the strips over from the render task and send frames of a
+ * test pattern one at a time, printing how long they took on the
+ * wire with the current RMT settings.
+ */
+int render_bench_refresh(unsigned int frames);
+
+// SPI clock of clocked strips, 0 in the settings is the default
+#define RENDER_CLOCKED_DEFAULT_KHZ 10000
+#define RENDER_CLOCKED_MAX_KHZ 40000
+
+// PWM frequencies of the single rgb led, leaving at least 8 bits of duty
+#define RENDER_LEDC_DEFAULT_FREQ 3000
+#define RENDER_LEDC_MIN_FREQ 100
+#define RENDER_LEDC_MAX_FREQ (80 * 1000 * 1000 / 256)
+
+/*
+ * Duty resolution in bits the single rgb led gets at the given PWM
+ * frequency, the highest the LEDC clock allows up to 16 bits.
+ * 0 if the frequency is out of range.
+ */
+int render_ledc_resolution(int32_t freq_hz);
+
+#endif
@@ -0,0 +1,438 @@
+// E1.31 (sACN) receiver, assumes a full UDP message is passed as one
+#include "sacn.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "render.h"
+#include "util.h"
+
+#define PORT 5568
+
+#define ACN_PACKET_IDENTIFIER "ASC-E1.17\0\0\0"
+#define ACN_PACKET_IDENTIFIER_LEN 12
+
+#define VECTOR_ROOT_E131_DATA 0x00000004
+#define VECTOR_ROOT_E131_EXTENDED 0x00000008
+#define VECTOR_E131_DATA_PACKET 0x00000002
+#define VECTOR_E131_EXTENDED_SYNCHRONIZATION 0x00000001
+#define VECTOR_DMP_SET_PROPERTY 0x02
+
+// Offsets into a data packet, the root layer is shared with sync packets
+#define ROOT_VECTOR 18
+#define FRAMING_VECTOR 40
+#define FRAMING_PRIORITY 108
+#define FRAMING_SYNC_ADDRESS 109
+#define FRAMING_SEQUENCE 111
+#define FRAMING_OPTIONS 112
+#define FRAMING_UNIVERSE 113
+#define DMP_VECTOR 117
+#define DMP_PROPERTY_COUNT 123
+#define DMP_START_CODE 125
+#define DATA_HEADER_LEN 126
+// Offsets into a sync packet
+#define SYNC_ADDRESS 45
+#define SYNC_PACKET_LEN 49
+
+#define OPTION_PREVIEW 0x80
+#define OPTION_TERMINATED 0x40
+
+#define MAX_PACKET_LEN (DATA_HEADER_LEN + DMX_UNIVERSE_SIZE)
+
+// Upper bound of packets handled before the pending frame is committed
+#define MAX_DRAIN_PACKETS 32
+
+// A frame spanning several universes is output at the latest this
+// long after its first universe arrived, even if some are missing
+#define FRAME_DEADLINE_MS 10
+// A frame waiting for a sync packet is output anyway after this long
+#define SYNC_DEADLINE_MS 100
+// E1.31 network data loss timeout, a silent source loses its universe
+#define SOURCE_TIMEOUT_MS 2500
+
+// Sequence numbers this far behind the last one are taken as reordered
+#define SEQUENCE_WINDOW 20
+
+static const char *TAG = "SACN";
+
+static int32_t first_universe;
+static unsigned int universe_count = 1;
+static uint32_t all_universes = 1;
+
+/*
+ * The source currently driving each universe of the frame. A source
+ * of a higher priority takes the universe over, otherwise the first
+ * one keeps it until it goes silent or terminates its stream.
+ */
+static struct {
+    uint8_t cid[16];
+    uint8_t priority;
+    uint8_t sequence;
+    int64_t last_time;      // 0 when the universe has no source
+} sources[RENDER_MAX_UNIVERSES];
+
+static struct {
+    uint32_t received;      // data packets written to the frame
+    uint32_t coalesced;     // frames replaced by a newer one before rendering
+    uint32_t synced;        // frames latched by a sync packet
+    uint32_t incomplete;    // frames output at a deadline
+    uint32_t takeovers;     // universes taken over by a higher priority source
+} counters;
+
+// Packets dropped, counted instead of logged
+static struct {
+    uint32_t foreign;       // universes we do not output
+    uint32_t priority;      // from a source not driving the universe
+    uint32_t sequence;      // reordered or duplicate
+    uint32_t other;         // preview data, alternate start codes, terminations
+    uint32_t invalid;       // not E1.31 or malformed
+} drops;
+
+static struct timing parse_timing;
+
+static bool frame_pending = false;
+static int64_t frame_pending_since;
+static uint32_t frame_universes;
+// Universe whose sync packets latch the pending frame, 0 outputs right away
+static uint16_t frame_sync_address;
+
+static int sock = -1;
+// Sync universe of the latest frame, its group is joined unless it
+// is one of our data universes
+static uint16_t sync_universe;
+static bool sync_joined = false;
+
+static uint32_t read_u32_be(const uint8_t *buf)
+{
+    return (uint32_t)buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+}
+
+static uint32_t universe_group(uint16_t universe)
+{
+    // 239.255.<universe high>.<universe low>
+    return htonl(0xefff0000 | universe);
+}
+
+static int set_membership(uint16_t universe, bool join)
+{
+    struct ip_mreq mreq = {
+        .imr_multiaddr.s_addr = universe_group(universe),
+        .imr_interface.s_addr = htonl(INADDR_ANY),
+    };
+    if (setsockopt(sock, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+                &mreq, sizeof(mreq)) != 0) {
+        ESP_LOGW(TAG, "Unable to %s universe %u: errno %d",
+                join ? "join" : "leave", universe, errno);
+        return -1;
+    }
+    return 0;
+}
+
+// Only the universes read by a strip are joined, the rest never reach us
+static void join_universes(void)
+{
+    for (unsigned int i = 0; i < universe_count; i++) {
+        if (all_universes & 1u << i) {
+            set_membership(first_universe + i, true);
+        }
+    }
+}
+
+// Sync packets go to the multicast group of their sync universe
+static void join_sync_universe(uint16_t address)
+{
+    if (address == sync_universe) {
+        return;
+    }
+    if (sync_joined) {
+        set_membership(sync_universe, false);
+    }
+    unsigned int index = address - first_universe;
+    bool data_universe = address >= first_universe && index < universe_count
+        && (all_universes & 1u << index);
+    sync_universe = address;
+    sync_joined = !data_universe && set_membership(address, true) == 0;
+}
+
+static void init(void)
+{
+    first_universe = render_first_universe();
+    universe_count = render_universe_count();
+    all_universes = render_universe_mask();
+    if (first_universe == 0) {
+        ESP_LOGW(TAG, "Universe 0 is not valid in sACN, it can only be driven over art-net");
+    }
+}
+
+static void commit_frame(void)
+{
+    frame_pending = false;
+    frame_universes = 0;
+    frame_sync_address = 0;
+    render_commit();
+}
+
+static int64_t pending_deadline(void)
+{
+    if (!frame_pending) {
+        return 0;
+    }
+    if (frame_sync_address != 0) {
+        return frame_pending_since + SYNC_DEADLINE_MS * 1000LL;
+    }
+    return frame_pending_since + FRAME_DEADLINE_MS * 1000LL;
+}
+
+static void flush_pending(void)
+{
+    if (!frame_pending) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (frame_sync_address == 0 && frame_universes == all_universes) {
+        commit_frame();
+    } else if (now >= pending_deadline()) {
+        counters.incomplete++;
+        commit_frame();
+    }
+}
+
+// Returns false if the packet must not drive the universe
+static bool accept_source(unsigned int index, const uint8_t *buf, int64_t rx_time_us)
+{
+    const uint8_t *cid = &buf[22];
+    uint8_t priority = buf[FRAMING_PRIORITY];
+    uint8_t seq = buf[FRAMING_SEQUENCE];
+    bool active = sources[index].last_time != 0
+        && rx_time_us - sources[index].last_time < SOURCE_TIMEOUT_MS * 1000LL;
+    bool same = active && memcmp(sources[index].cid, cid, sizeof(sources[index].cid)) == 0;
+
+    if (same) {
+        int8_t ahead = seq - sources[index].sequence;
+        if (ahead <= 0 && ahead > -SEQUENCE_WINDOW) {
+            drops.sequence++;
+            return false;
+        }
+        if (buf[FRAMING_OPTIONS] & OPTION_TERMINATED) {
+            // The source is done, the universe is free for the others
+            sources[index].last_time = 0;
+            drops.other++;
+            return false;
+        }
+    } else {
+        if (buf[FRAMING_OPTIONS] & OPTION_TERMINATED) {
+            drops.other++;
+            return false;
+        }
+        if (active && priority <= sources[index].priority) {
+            drops.priority++;
+            return false;
+        }
+        if (active) {
+            counters.takeovers++;
+        }
+        memcpy(sources[index].cid, cid, sizeof(sources[index].cid));
+    }
+
+    sources[index].priority = priority;
+    sources[index].sequence = seq;
+    sources[index].last_time = rx_time_us;
+    return true;
+}
+
+static void handle_data(const uint8_t *buf, size_t len, int64_t rx_time_us)
+{
+    if (len < DATA_HEADER_LEN
+            || read_u32_be(&buf[FRAMING_VECTOR]) != VECTOR_E131_DATA_PACKET
+            || buf[DMP_VECTOR] != VECTOR_DMP_SET_PROPERTY) {
+        drops.invalid++;
+        return;
+    }
+
+    uint16_t universe = buf[FRAMING_UNIVERSE] << 8 | buf[FRAMING_UNIVERSE + 1];
+    unsigned int index = universe - first_universe;
+    if (universe < first_universe || index >= universe_count
+            || !(all_universes & 1u << index)) {
+        drops.foreign++;
+        return;
+    }
+
+    // Property values are the start code and the slots
+    uint16_t count = buf[DMP_PROPERTY_COUNT] << 8 | buf[DMP_PROPERTY_COUNT + 1];
+    if (count < 1 || count > 1 + DMX_UNIVERSE_SIZE || len < DMP_START_CODE + count) {
+        drops.invalid++;
+        return;
+    }
+    if (buf[DMP_START_CODE] != 0 || buf[FRAMING_OPTIONS] & OPTION_PREVIEW) {
+        drops.other++;
+        return;
+    }
+    if (!accept_source(index, buf, rx_time_us)) {
+        return;
+    }
+
+    counters.received++;
+    if (render_write(index, &buf[DATA_HEADER_LEN], count - 1, rx_time_us)) {
+        counters.coalesced++;
+    }
+    frame_universes |= 1u << index;
+    if (!frame_pending) {
+        frame_pending = true;
+        frame_pending_since = rx_time_us;
+    }
+    uint16_t sync_address = buf[FRAMING_SYNC_ADDRESS] << 8 | buf[FRAMING_SYNC_ADDRESS + 1];
+    if (sync_address != 0) {
+        join_sync_universe(sync_address);
+    }
+    frame_sync_address = sync_address;
+}
+
+static void handle_sync(const uint8_t *buf, size_t len)
+{
+    if (len < SYNC_PACKET_LEN
+            || read_u32_be(&buf[FRAMING_VECTOR]) != VECTOR_E131_EXTENDED_SYNCHRONIZATION) {
+        drops.invalid++;
+        return;
+    }
+    uint16_t address = buf[SYNC_ADDRESS] << 8 | buf[SYNC_ADDRESS + 1];
+    if (frame_pending && frame_sync_address != 0 && address == frame_sync_address) {
+        counters.synced++;
+        commit_frame();
+    }
+}
+
+static void handle_sacn(const uint8_t *buf, size_t len, int64_t rx_time_us)
+{
+    if (len < FRAMING_VECTOR + 4
+            || memcmp(&buf[4], ACN_PACKET_IDENTIFIER, ACN_PACKET_IDENTIFIER_LEN) != 0) {
+        drops.invalid++;
+        return;
+    }
+
+    switch (read_u32_be(&buf[ROOT_VECTOR])) {
+    case VECTOR_ROOT_E131_DATA:
+        handle_data(buf, len, rx_time_us);
+        break;
+    case VECTOR_ROOT_E131_EXTENDED:
+        handle_sync(buf, len);
+        break;
+    default:
+        drops.other++;
+        break;
+    }
+}
+
+static void sacn_worker(void *bogus)
+{
+    uint8_t rx_buffer[MAX_PACKET_LEN];
+    struct sockaddr_in dest_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    int listen_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (listen_sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    int err = bind(listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+    if (err != 0) {
+        ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
+        goto CLEAN_UP;
+    }
+    ESP_LOGI(TAG, "Socket bound, port %d", PORT);
+    sock = listen_sock;
+    join_universes();
+
+    while (1) {
+        int ready = socket_wait(listen_sock, pending_deadline());
+        if (ready < 0) {
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
+            break;
+        }
+        if (ready == 0) {
+            flush_pending();
+            continue;
+        }
+
+        int recv_len = recvfrom(listen_sock, rx_buffer, sizeof(rx_buffer), 0, NULL, NULL);
+        if (recv_len < 0) {
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            break;
+        }
+
+        // Drain the socket so only the newest frame gets rendered
+        for (int drained = 0; recv_len >= 0; drained++) {
+            int64_t rx_time = esp_timer_get_time();
+            handle_sacn(rx_buffer, recv_len, rx_time);
+            timing_add(&parse_timing, esp_timer_get_time() - rx_time);
+
+            if (drained == MAX_DRAIN_PACKETS) {
+                break;
+            }
+            recv_len = recvfrom(listen_sock, rx_buffer, sizeof(rx_buffer), MSG_DONTWAIT, NULL, NULL);
+        }
+
+        if (recv_len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            break;
+        }
+
+        flush_pending();
+    }
+
+CLEAN_UP:
+    sock = -1;
+    close(listen_sock);
+    vTaskDelete(NULL);
+}
+
+#define STACK_SIZE 3000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+static TaskHandle_t task_handle = NULL;
+
+void sacn_print_stats(void)
+{
+    printf("sacn frames received: %"PRIu32", coalesced: %"PRIu32", synced: %"PRIu32
+            ", incomplete: %"PRIu32"\n",
+            counters.received, counters.coalesced, counters.synced, counters.incomplete);
+    printf("sacn sources taken over: %"PRIu32", sync universe: %u\n",
+            counters.takeovers, sync_universe);
+    printf("sacn dropped, foreign universe: %"PRIu32", priority: %"PRIu32", sequence: %"PRIu32
+            ", other: %"PRIu32", invalid: %"PRIu32"\n",
+            drops.foreign, drops.priority, drops.sequence, drops.other, drops.invalid);
+    timing_print("sacn parse", &parse_timing);
+}
+
+void sacn_task_start(void)
+{
+    init();
+
+    task_handle = xTaskCreateStatic(
+            sacn_worker,
+            "sacn",
+            STACK_SIZE,
+            (void*) 0,
+            // Same as art-net, above the render task
+            5,
+            xStack,
+            &xTaskBuffer
+            );
+}
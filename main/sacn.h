@@ -0,0 +1,13 @@
+#ifndef _SACN_H
+#define _SACN_H
+
+/*
+ * E1.31 (sACN) receiver next to the art-net one. It reads the same
+ * universes, numbered the same way, and only joins the multicast
+ * groups of those, plus the sync universe the sender uses.
+ */
+void sacn_task_start(void);
+
+void sacn_print_stats(void);
+
+#endif
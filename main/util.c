@@ -1,11 +1,18 @@
 #include "util.h"
 
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <sys/select.h>
+
 #include "string.h"
 
 #include "esp_log.h"
 #include "esp_mac.h"
+#include "esp_timer.h"
 
 static char MACHEX[18];
+static uint8_t mac_bytes[6];
 
 static const char *TAG = "UTIL";
 
@@ -13,6 +20,7 @@ static void mac_init(void)
 {
     unsigned char MAC[8];
     ESP_ERROR_CHECK(esp_efuse_mac_get_default(MAC));
+    memcpy(mac_bytes, MAC, sizeof(mac_bytes));
     sprintf(MACHEX, "%X", MAC[0]);
     unsigned int len = strlen((char*)MAC);
     for(int i = 1; i < len; i++)
@@ -33,3 +41,44 @@ const char* get_mac(void)
 {
     return MACHEX;
 }
+
+void get_mac_bytes(uint8_t mac[6])
+{
+    memcpy(mac, mac_bytes, sizeof(mac_bytes));
+}
+
+int socket_wait(int sock, int64_t deadline_us)
+{
+    if (deadline_us == 0) {
+        // Nothing pending, just block in recvfrom
+        return 1;
+    }
+    int64_t remaining = deadline_us - esp_timer_get_time();
+    if (remaining <= 0) {
+        return 0;
+    }
+    struct timeval tv = {
+        .tv_sec = remaining / 1000000,
+        .tv_usec = remaining % 1000000,
+    };
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    return select(sock + 1, &fds, NULL, NULL, &tv);
+}
+
+void timing_add(struct timing *t, int64_t us)
+{
+    t->count++;
+    t->total_us += us;
+    if (us > t->max_us) {
+        t->max_us = us;
+    }
+}
+
+void timing_print(const char *name, const struct timing *t)
+{
+    int64_t avg = t->count ? t->total_us / t->count : 0;
+    printf("%-10s n: %"PRIu32", avg: %"PRId64" us, max: %"PRId64" us\n",
+            name, t->count, avg, t->max_us);
+}
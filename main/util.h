@@ -1,8 +1,34 @@
 #ifndef _UTIL_H
 #define _UTIL_H
 
+#include <stdint.h>
+
 void util_init(void);
 
 const char* get_mac(void);
+// The same MAC as get_mac(), as the six raw bytes
+void get_mac_bytes(uint8_t mac[6]);
+
+/*
+ * Wait until the socket is readable or deadline_us, an esp_timer
+ * time, passes. A deadline of 0 returns right away as readable,
+ * the caller then blocks in recvfrom.
+ * Returns > 0 if readable, 0 on timeout and < 0 on error.
+ */
+int socket_wait(int sock, int64_t deadline_us);
+
+/*
+ * Accumulated duration of a pipeline stage, in microseconds.
+ * Only written by a single task, readers may see torn values
+ * which is fine for diagnostics.
+ */
+struct timing {
+    uint32_t count;
+    int64_t total_us;
+    int64_t max_us;
+};
+
+void timing_add(struct timing *t, int64_t us);
+void timing_print(const char *name, const struct timing *t);
 
 #endif
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Send an ArtPoll and print the ArtPollReply and ArtDiagData packets that come back.
+
+    tools/artpoll.py                       broadcast, print every node
+    tools/artpoll.py 192.168.1.50 -d       one node, with diagnostics
+    tools/artpoll.py -t 0 3 -w 60          nodes outputting universes 0-3, watch replies on change
+
+Nodes answer to port 6454, so nothing else on this host may hold it
+without SO_REUSEADDR. Replies not exactly 239 bytes long are reported.
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+PORT = 6454
+HEADER = b"Art-Net\0"
+PROTOCOL_VERSION = 14
+
+OPCODE_POLL = 0x2000
+OPCODE_POLL_REPLY = 0x2100
+OPCODE_DIAG_DATA = 0x2300
+
+POLL_FLAG_REPLY_ON_CHANGE = 0x02
+POLL_FLAG_DIAGNOSTICS = 0x04
+POLL_FLAG_DIAG_UNICAST = 0x08
+POLL_FLAG_TARGETED = 0x20
+
+POLL_REPLY_LEN = 239
+DIAG_HEADER_LEN = 18
+
+DIAG_PRIORITIES = {"low": 0x10, "medium": 0x40, "high": 0x80, "critical": 0xe0, "volatile": 0xf0}
+
+
+def poll_packet(flags, priority, bottom, top):
+    # Header, opcode, protocol version, flags, diag priority, target port addresses, EstaMan, Oem
+    return (HEADER + struct.pack("<H", OPCODE_POLL) + struct.pack(">H", PROTOCOL_VERSION)
+            + bytes([flags, priority]) + struct.pack(">HHHH", top, bottom, 0, 0))
+
+
+def cstring(data):
+    return data.split(b"\0", 1)[0].decode("latin-1")
+
+
+def ip(data):
+    return socket.inet_ntoa(data)
+
+
+def print_poll_reply(source, buf):
+    if len(buf) != POLL_REPLY_LEN:
+        print(f"  ! {len(buf)} bytes, expected {POLL_REPLY_LEN}")
+        buf = buf.ljust(POLL_REPLY_LEN, b"\0")
+    net, sub = buf[18], buf[19]
+    ports = struct.unpack(">H", buf[172:174])[0]
+    print(f"ArtPollReply from {source[0]}")
+    print(f"  ip            {ip(buf[10:14])}:{struct.unpack('<H', buf[14:16])[0]}")
+    print(f"  firmware      {struct.unpack('>H', buf[16:18])[0]:#06x}")
+    print(f"  oem / esta    {struct.unpack('>H', buf[20:22])[0]:#06x} / {struct.unpack('<H', buf[24:26])[0]:#06x}")
+    print(f"  status        {buf[23]:#04x} {buf[212]:#04x} {buf[217]:#04x}")
+    print(f"  short name    {cstring(buf[26:44])!r}")
+    print(f"  long name     {cstring(buf[44:108])!r}")
+    print(f"  report        {cstring(buf[108:172])!r}")
+    print(f"  style         {buf[200]}")
+    print(f"  mac           {buf[201:207].hex(':')}")
+    print(f"  bind          {ip(buf[207:211])} index {buf[211]}")
+    print(f"  ports         {ports}")
+    for i in range(min(ports, 4)):
+        address = (net & 0x7f) << 8 | (sub & 0x0f) << 4 | (buf[190 + i] & 0x0f)
+        print(f"    {i}: universe {address:5}  type {buf[174 + i]:#04x}  "
+              f"good output {buf[182 + i]:#04x}/{buf[213 + i]:#04x}  good input {buf[178 + i]:#04x}")
+
+
+def print_diag(source, buf):
+    if len(buf) < DIAG_HEADER_LEN:
+        print(f"ArtDiagData from {source[0]}: {len(buf)} bytes, too short")
+        return
+    length = struct.unpack(">H", buf[16:18])[0]
+    text = cstring(buf[DIAG_HEADER_LEN:DIAG_HEADER_LEN + length])
+    note = "" if len(buf) >= DIAG_HEADER_LEN + length else f" (length {length}, only {len(buf) - DIAG_HEADER_LEN} sent)"
+    print(f"ArtDiagData from {source[0]} priority {buf[13]:#04x} port {buf[14]}: {text!r}{note}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("target", nargs="?", default="255.255.255.255", help="node or broadcast address")
+    parser.add_argument("-w", "--wait", type=float, default=3, help="seconds to listen for replies")
+    parser.add_argument("-d", "--diag", nargs="?", const="low", choices=DIAG_PRIORITIES,
+                        help="ask for ArtDiagData of at least this priority")
+    parser.add_argument("-u", "--unicast", action="store_true", help="ask for diagnostics unicast to us")
+    parser.add_argument("-c", "--on-change", action="store_true", help="ask for a reply whenever a node changes")
+    parser.add_argument("-t", "--targeted", nargs=2, type=int, metavar=("BOTTOM", "TOP"),
+                        help="only nodes with a port address in this range reply")
+    args = parser.parse_args()
+
+    flags = 0
+    priority = DIAG_PRIORITIES["low"]
+    if args.diag:
+        flags |= POLL_FLAG_DIAGNOSTICS
+        priority = DIAG_PRIORITIES[args.diag]
+        if args.unicast:
+            flags |= POLL_FLAG_DIAG_UNICAST
+    if args.on_change:
+        flags |= POLL_FLAG_REPLY_ON_CHANGE
+    bottom, top = 0, 0x7fff
+    if args.targeted:
+        flags |= POLL_FLAG_TARGETED
+        bottom, top = args.targeted
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    sock.bind(("", PORT))
+    packet = poll_packet(flags, priority, bottom, top)
+    sock.sendto(packet, (args.target, PORT))
+
+    nodes = set()
+    end = time.monotonic() + args.wait
+    while (left := end - time.monotonic()) > 0:
+        sock.settimeout(left)
+        try:
+            buf, source = sock.recvfrom(1024)
+        except socket.timeout:
+            break
+        if len(buf) < 10 or buf[:8] != HEADER:
+            continue
+        opcode = struct.unpack("<H", buf[8:10])[0]
+        if opcode == OPCODE_POLL_REPLY:
+            nodes.add(source[0])
+            print_poll_reply(source, buf)
+        elif opcode == OPCODE_DIAG_DATA:
+            print_diag(source, buf)
+    print(f"{len(nodes)} node(s) replied")
+
+
+if __name__ == "__main__":
+    main()
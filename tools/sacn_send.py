@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""Send E1.31 (sACN) streams to test the receiver from Linux.
+
+    tools/sacn_send.py send -u 1 -c ff0000            red on universe 1 until interrupted
+    tools/sacn_send.py takeover -u 1                  priority takeover and stream termination
+    tools/sacn_send.py sequence -u 1                  reordered, duplicate and restarted sequences
+    tools/sacn_send.py sync -u 1 -n 2                 frames over two universes latched by sync packets
+
+Packets go to the universe multicast groups unless --target gives a
+unicast address. Colors are repeated over the whole universe, one
+pixel per --stride slots; with a stride of 4 the intensity slot is full,
+as the default rgbi input expects. Every scenario step says what the
+leds should show; the 'stats' console command counts the drops.
+"""
+
+import argparse
+import socket
+import struct
+import time
+import uuid
+
+PORT = 5568
+ACN_PACKET_IDENTIFIER = b"ASC-E1.17\0\0\0"
+
+VECTOR_ROOT_E131_DATA = 0x00000004
+VECTOR_ROOT_E131_EXTENDED = 0x00000008
+VECTOR_E131_DATA_PACKET = 0x00000002
+VECTOR_E131_EXTENDED_SYNCHRONIZATION = 0x00000001
+VECTOR_DMP_SET_PROPERTY = 0x02
+
+OPTION_PREVIEW = 0x80
+OPTION_TERMINATED = 0x40
+
+DMX_UNIVERSE_SIZE = 512
+DEFAULT_PRIORITY = 100
+# The receiver drops sequence numbers up to this far behind the last one
+SEQUENCE_WINDOW = 20
+# A source silent this long loses its universes
+SOURCE_TIMEOUT_S = 2.5
+
+
+def flags_length(length):
+    return struct.pack(">H", 0x7000 | length)
+
+
+def root_layer(length, vector, cid):
+    # Preamble and postamble size, identifier, then the PDU from offset 16
+    return (struct.pack(">HH", 0x0010, 0) + ACN_PACKET_IDENTIFIER
+            + flags_length(length - 16) + struct.pack(">I", vector) + cid)
+
+
+def data_packet(cid, name, universe, slots, sequence, priority=DEFAULT_PRIORITY, sync_address=0, options=0):
+    length = 126 + len(slots)
+    framing = (flags_length(length - 38) + struct.pack(">I", VECTOR_E131_DATA_PACKET)
+               + name.encode()[:63].ljust(64, b"\0")
+               + struct.pack(">BHBBH", priority, sync_address, sequence & 0xff, options, universe))
+    dmp = (flags_length(length - 115) + struct.pack(">BBHHH", VECTOR_DMP_SET_PROPERTY, 0xa1, 0, 1, 1 + len(slots))
+           + b"\0" + slots)
+    return root_layer(length, VECTOR_ROOT_E131_DATA, cid) + framing + dmp
+
+
+def sync_packet(cid, sync_address, sequence):
+    framing = (flags_length(49 - 38) + struct.pack(">I", VECTOR_E131_EXTENDED_SYNCHRONIZATION)
+               + struct.pack(">BHH", sequence & 0xff, sync_address, 0))
+    return root_layer(49, VECTOR_ROOT_E131_EXTENDED, cid) + framing
+
+
+class Source:
+    """One sACN source, its own CID, name and sequence numbers."""
+
+    def __init__(self, args, name, priority=DEFAULT_PRIORITY):
+        self.args = args
+        self.name = name
+        self.priority = priority
+        self.cid = uuid.uuid5(uuid.NAMESPACE_DNS, f"{name}.sacn_send").bytes
+        self.sequence = 0
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+
+    def destination(self, universe):
+        if self.args.target:
+            return (self.args.target, PORT)
+        return (f"239.255.{universe >> 8}.{universe & 0xff}", PORT)
+
+    def next_sequence(self):
+        self.sequence = (self.sequence + 1) & 0xff
+        return self.sequence
+
+    def send(self, color, sequence=None, sync_address=0, options=0):
+        """Send one frame of color to every universe, with one sequence number per packet."""
+        for universe in universes(self.args):
+            seq = self.next_sequence() if sequence is None else sequence
+            packet = data_packet(self.cid, self.name, universe, slots(self.args, color), seq,
+                                 self.priority, sync_address, options)
+            self.sock.sendto(packet, self.destination(universe))
+
+    def sync(self, sync_address):
+        self.sock.sendto(sync_packet(self.cid, sync_address, self.next_sequence()), self.destination(sync_address))
+
+    def terminate(self, color):
+        # E1.31 asks for three packets with the terminated bit
+        for _ in range(3):
+            self.send(color, options=OPTION_TERMINATED)
+
+
+def universes(args):
+    return range(args.universe, args.universe + args.count)
+
+
+def slots(args, color):
+    pixel = bytes.fromhex(color) + (b"\xff" if args.stride == 4 else b"")
+    return (pixel * (DMX_UNIVERSE_SIZE // len(pixel) + 1))[:DMX_UNIVERSE_SIZE]
+
+
+def stream(args, seconds, *senders):
+    """Call every sender once per frame for seconds."""
+    end = time.monotonic() + seconds
+    while time.monotonic() < end:
+        for sender in senders:
+            sender()
+        time.sleep(1 / args.rate)
+
+
+def step(text):
+    print(f"- {text}", flush=True)
+
+
+def run_send(args):
+    source = Source(args, args.name, args.priority)
+    step(f"{args.name} priority {args.priority}: {args.color} at {args.rate} fps")
+    try:
+        stream(args, args.duration or float("inf"), lambda: source.send(args.color))
+    except KeyboardInterrupt:
+        pass
+    if args.terminate:
+        step("stream terminated")
+        source.terminate(args.color)
+
+
+def run_takeover(args):
+    low = Source(args, "low", 50)
+    main = Source(args, "main", 100)
+    high = Source(args, "high", 150)
+    hold = args.hold
+
+    step("main priority 100 sends red: red")
+    stream(args, hold, lambda: main.send("ff0000"))
+    step("low priority 50 sends green as well: still red, priority drops")
+    stream(args, hold, lambda: main.send("ff0000"), lambda: low.send("00ff00"))
+    step("high priority 150 sends blue as well: blue, one takeover per universe")
+    stream(args, hold, lambda: main.send("ff0000"), lambda: low.send("00ff00"), lambda: high.send("0000ff"))
+    step("high terminates its stream: red, the universe is free and main outranks low")
+    high.terminate("0000ff")
+    stream(args, hold, lambda: main.send("ff0000"), lambda: low.send("00ff00"))
+    step(f"only low keeps sending: green once main times out after {SOURCE_TIMEOUT_S} s")
+    stream(args, hold + SOURCE_TIMEOUT_S, lambda: low.send("00ff00"))
+    step("terminated packets of a source not driving the universe: still green")
+    main.terminate("ff0000")
+    stream(args, hold, lambda: low.send("00ff00"))
+    low.terminate("00ff00")
+
+
+def run_sequence(args):
+    source = Source(args, "main")
+    hold = args.hold
+
+    step("white at sequence 100")
+    stream(args, hold, lambda: source.send("ffffff", sequence=100))
+    step("duplicates of 100 in red: still white, sequence drops")
+    stream(args, hold, lambda: source.send("ff0000", sequence=100))
+    step(f"red at {SEQUENCE_WINDOW - 1} behind, inside the window: still white, sequence drops")
+    stream(args, hold, lambda: source.send("ff0000", sequence=100 - (SEQUENCE_WINDOW - 1)))
+    step(f"green at {SEQUENCE_WINDOW} behind, outside the window: green, taken as a restarted sender")
+    stream(args, hold, lambda: source.send("00ff00", sequence=100 - SEQUENCE_WINDOW))
+    step("blue counting up across the 255 to 0 wrap: blue, nothing dropped")
+    source.sequence = 200
+    stream(args, hold, lambda: source.send("0000ff"))
+    source.terminate("0000ff")
+
+
+def run_sync(args):
+    source = Source(args, "main")
+    address = args.sync_universe
+    hold = args.hold
+
+    step(f"red with sync address {address}, synced at every frame: red")
+    stream(args, hold, lambda: (source.send("ff0000", sync_address=address), source.sync(address)))
+    step("green without any sync packet: green, output at the 100 ms sync deadline, incomplete count grows")
+    stream(args, hold, lambda: source.send("00ff00", sync_address=address))
+    step(f"blue, synced on universe {address + 1} only: blue, still output at the deadline")
+    stream(args, hold, lambda: (source.send("0000ff", sync_address=address), source.sync(address + 1)))
+    step("white synced once per second: white, changes land on the sync")
+    end = time.monotonic() + hold
+    colors = ["ffffff", "000000"]
+    while time.monotonic() < end:
+        color = colors[0]
+        colors.reverse()
+        source.send(color, sync_address=address)
+        time.sleep(0.05)
+        step(f"  sync {color}")
+        source.sync(address)
+        time.sleep(0.95)
+    step("without sync address: red right away")
+    stream(args, hold, lambda: source.send("ff0000"))
+    source.terminate("ff0000")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("-t", "--target", help="unicast to this address instead of multicast")
+    parser.add_argument("-u", "--universe", type=int, default=1, help="first universe")
+    parser.add_argument("-n", "--count", type=int, default=1, help="consecutive universes per frame")
+    parser.add_argument("-s", "--stride", type=int, choices=(3, 4), default=4, help="slots per pixel")
+    parser.add_argument("-r", "--rate", type=float, default=30, help="frames per second")
+    parser.add_argument("--hold", type=float, default=3, help="seconds per scenario step")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    send = commands.add_parser("send", help="stream one color")
+    send.add_argument("-c", "--color", default="ffffff", help="RGB hex")
+    send.add_argument("-p", "--priority", type=int, default=DEFAULT_PRIORITY)
+    send.add_argument("--name", default="sacn_send", help="source name, also sets the CID")
+    send.add_argument("-d", "--duration", type=float, help="seconds, until interrupted if not given")
+    send.add_argument("--terminate", action="store_true", help="end with a stream termination")
+    send.set_defaults(run=run_send)
+
+    commands.add_parser("takeover", help="priorities, termination and source timeout").set_defaults(run=run_takeover)
+    commands.add_parser("sequence", help="sequence window and wrap").set_defaults(run=run_sequence)
+    sync = commands.add_parser("sync", help="synchronized output")
+    sync.add_argument("--sync-universe", type=int, default=7999, help="universe of the sync packets")
+    sync.set_defaults(run=run_sync)
+
+    args = parser.parse_args()
+    if not 1 <= args.universe or args.universe + args.count > 64000:
+        parser.error("universes must be within 1-63999")
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()